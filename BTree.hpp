@@ -1,11 +1,33 @@
 #ifndef BTREE_HPP
 #define BTREE_HPP
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include "LinkedList.hpp"
-#include "StackLinkedList.hpp"
-#include "QueueLinkedList.hpp"
+#include "StackArray.hpp"
+#include "QueueArray.hpp"
+#include "FrozenBTree.hpp"
+#include "EpochReclaimer.hpp"
+#include "CoroutineLookup.hpp"
+
+//Statistics and trace hooks are compiled in only with BTREE_INSTRUMENTATION defined
+#ifdef BTREE_INSTRUMENTATION
+#include "BTreeInstrumentation.hpp"
+#define BTREE_OPERATION(kind) BTreeInstrumentation::scope instrumentation_scope(this->instrumentation, BTreeInstrumentation::operation::kind)
+#define BTREE_TRACE(event) this->instrumentation.trace(BTreeInstrumentation::trace_event::event)
+#else
+#define BTREE_OPERATION(kind)
+#define BTREE_TRACE(event)
+#endif
 
 template <class T>
 class BTree
@@ -18,13 +40,16 @@ class BTree
 		LinkedList<T> node_data;
 		LinkedList<Node*> children;
 		node_situation situation;
+		//Bloom filter of a leaf's elements, an empty one says nothing (see leaf filters)
+		std::vector<unsigned long long> filter;
 
 		Node() {this->situation =node_situation::empty;}
 		Node(LinkedList<T> node_data) : node_data(node_data) {this->situation = node_situation::normal;}
 		Node(const Node& node) : Node() {*this = node;}
 
-		void insert_to_node(T data, int max_node_data_length);
-		T remove_from_node(int index, int min_node_data_length);
+		bool insert_to_node(T data, int max_node_data_length);
+		T remove_from_node(int index, int min_node_data_length, const BTree& tree);
+		void update_situation(int max_node_data_length);
 
 		bool is_leaf() const;
 
@@ -36,28 +61,194 @@ class BTree
 	int min_node_data_length;
 	int max_node_degree;
 
-	Node* search_with_path(T data, int& index, Stack<Node*>& path);
-	Node* place_to_insert(T data, int& index, Stack<Node*>& path);
-	Node* pre_inorder(Node *start, int& index, Stack<Node*>& path);
+	//Changes whenever nodes are created, deleted or rearranged. Iterators kept
+	//as hints are only trusted while their version matches.
+	unsigned long structure_version;
+	std::vector<Node*> rightmost_path;
+	unsigned long rightmost_version;
 
-	Node* search_with_path_and_index(T data, int& index, Stack<Node*>& path, Stack<Node*>& path_left, Stack<Node*>& path_right, Stack<int>& indices);
-	Node* pre_inorder_with_index(Node *start, int& index, Stack<Node*>& path, Stack<Node*>& path_left, Stack<Node*>& path_right, Stack<int>& indices);
+	Node* find_node(const T& data) const;
+	Node* search_with_path(T data, int& index, ArrayStack<Node*>& path);
+	Node* place_to_insert(T data, int& index, ArrayStack<Node*>& path);
+	Node* pre_inorder(Node *start, int& index, ArrayStack<Node*>& path);
 
-	void split(Node *node, Node *parent);//ok1
+	Node* search_with_path_and_index(T data, int& index, ArrayStack<Node*>& path, ArrayStack<Node*>& path_left, ArrayStack<Node*>& path_right, ArrayStack<int>& indices);
+	Node* pre_inorder_with_index(Node *start, int& index, ArrayStack<Node*>& path, ArrayStack<Node*>& path_left, ArrayStack<Node*>& path_right, ArrayStack<int>& indices);
+
+	void split(Node *node, Node *parent, bool right_edge = false);//ok1
+	void split_upwards(ArrayStack<Node*>& path, bool right_edge = false);
 	bool can_borrow(Node *node_borrower, Node *node_sharer) const; 
 	void borrow_from_left(Node *node_borrower, Node *node_sharer, Node *parent, int index);
 	void borrow_from_right(Node *node_borrower, Node *node_sharer, Node *parent, int index);
 	void merge_left(Node* empty, Node* left_sibling, Node* parent, int index);
 	void merge_right(Node* empty, Node* right_sibling, Node* parent, int index);
 
-	void inorder_display(Node *node) const;
+	template <class F>
+	void for_each_inorder(Node *node, F& function) const;
+	static void flush_display(std::ostringstream& buffer, std::ostream& out, bool force);
+
+	//Unit of parallel work: a whole subtree, or a single element of an upper node
+	struct traversal_task
+	{
+		Node *subtree;
+		const T *data;
+	};
+
+	void create_tasks(int thread_count, std::vector<traversal_task>& tasks) const;
+	void create_tasks(Node *node, int depth, int split_depth, std::vector<traversal_task>& tasks) const;
+	template <class F>
+	void for_each_block(const traversal_task& task, F& function) const;
+	template <class F>
+	static void run_tasks(int task_count, int thread_count, F function);
+	static int default_thread_count(int thread_count);
+
+	void create_data_list(Node* node, ArrayQueue<T>& inorder_data_list);
+
+	//Lazy removal: removed elements stay in their nodes and are only listed here (sorted)
+	//until they are purged, so deletes don't rebalance the tree synchronously.
+	//Once max_tombstones is reached, every removal purges at most purge_step of them.
+	static const int purge_step = 4;
+	bool lazy_removal;
+	int max_tombstones;
+	std::set<T> tombstones;
+
+	bool is_tombstone(const T& data) const;
+	bool revive(const T& data);
+	bool has_live_data(Node *node) const;
+	void apply_removal(T data);
+	void remove_from_tree(T data);
+
+	//Write buffered mode: inserts and removes wait here until the buffer is full,
+	//then they are applied as one sorted batch. Only the latest message of an element
+	//is kept (true for removal), reads look it up on top of the tree and iterators
+	//merge the buffered inserts into the walk over the nodes.
+	int write_buffer_capacity;
+	std::map<T, bool> write_buffer;
+
+	void buffer_message(const T& data, bool removal);
+	bool find_buffered(const T& data, bool& removal) const;
+	bool is_hidden(const T& data) const;
+	void insert_into_tree(T data);
+	Node* find_leaf(const T& data, ArrayStack<Node*>& path, const T*& upper_bound) const;
+	void settle();
+
+	//Split and join of whole subtrees, heights are counted from leaves (0) and empty subtree is -1
+	int node_height(Node *node) const;
+	void trim_root(Node*& node, int& height);
+	Node* join_roots(Node *left, int left_height, const T& separator, Node *right, int right_height, int& height);
+	void split_subtree(Node *node, int height, const T& key, Node*& left, int& left_height, Node*& right, int& right_height);
+	void split_tree(const T& key, BTree& right);
+	void join_tree(BTree& right);
+	Node* edge_leaf(bool rightmost) const;
+
+	//Builds a tree bottom up from ascending elements given one by one.
+	//Only the rightmost node of every level is open, the others are already complete.
+	struct bulk_builder
+	{
+		std::vector<Node*> open;
+		int fill;
+	};
 
-	void create_data_list(Node* node, Queue<T>& inorder_data_list);
+	void build_push(bulk_builder& builder, const T& data, int level = 0);
+	Node* build_finish(bulk_builder& builder);
+	template <class P>
+	void build_merged(const BTree& lhs, const BTree& rhs, P keep);
 
 	void rec_create(Node* to, Node* from);
+	void copy_configuration(const BTree& from);
+
+	//With a reclaimer, nodes and list cells taken out of the tree are retired, so what a
+	//guarded reader got under a lock stays allocated after the lock is released.
+	//Links aren't atomic, readers still have to be synchronized with the writers.
+	EpochReclaimer *reclaimer;
+	void release_node(Node *node) const;
+	template <class C>
+	void release_cell(C *cell) const;
+	template <class D>
+	void remove_cell(LinkedList<D>& list, int index) const;
+
+#ifdef BTREE_INSTRUMENTATION
+	mutable BTreeInstrumentation instrumentation;
+#endif
+
+	//Leaf filters: a leaf's filter only ever gains bits when elements are added, so it stays a
+	//superset of the leaf even while lookups don't use it. Rebuilds drop the bits of removed
+	//elements and only happen while filters are enabled. A filter has about 8 bits for every
+	//element a full leaf holds, and an element sets 3 bits of a single word of it.
+	bool leaf_filters;
+
+	static unsigned long long filter_hash(const T& data);
+	static unsigned long long filter_mask(unsigned long long hash);
+	static bool filter_rules_out(const Node *node, unsigned long long hash);
+	int filter_words() const;
+	void add_to_filter(Node *node, const T& data) const;
+	void merge_filter(Node *node, const Node *merged) const;
+	void rebuild_filter(Node *node) const;
+
+	bool in_node_range(Node* node, const T& data) const;
+	void refresh_rightmost_path();
+
+public:
+	//balanced: split from the middle
+	//right_edge: splits caused by appending after the biggest element move only the new element to the new node
+	//automatic: right_edge splits once consecutive appends are detected
+	enum class split_policy{balanced, right_edge, automatic};
+
+	//Bytes are counted from object sizes, allocator headers are not included
+	struct memory_report
+	{
+		int node_count;
+		int element_count;
+		long long node_bytes;//Node objects themselves
+		long long key_bytes;//element payload
+		long long link_bytes;//list cells of elements without their payload
+		long long child_pointer_bytes;//list cells of children
+		long long buffer_bytes;//write buffer and tombstones
+		long long slack_bytes;//node and child bytes of the nodes a completely full tree wouldn't need
+		long long total_bytes;
+		double fill_factor;//elements over the capacity of the nodes
+	};
+
+	class const_iterator
+	{
+		const BTree* tree;
+		std::vector<Node*> nodes;
+		std::vector<int> indices;
+		typename LinkedList<T>::Node* current;
+		typename std::map<T, bool>::const_iterator message;//next buffered insert
+		unsigned long version;
+
+		const_iterator(const BTree* tree) : tree(tree), current(nullptr), message(tree->write_buffer.end()), version(tree->structure_version) {}
+
+		void step();
+		void settle();
+		bool at_end() const;
+		bool from_buffer() const;
+
+	public:
+		const_iterator() : tree(nullptr), current(nullptr), version(0) {}
+
+		const T& operator*() const;
+		const T* operator->() const;
+		const_iterator& operator++();
+		const_iterator operator++(int);
+
+		bool operator==(const const_iterator& rhs) const;
+		bool operator!=(const const_iterator& rhs) const;
+
+		friend class BTree;
+	};
+
+private:
+	bool is_valid_hint(const const_iterator& hint) const;
+	bool descend_from(const T& data, const_iterator& position) const;
+	bool locate_from(const const_iterator& hint, const T& data, const_iterator& position) const;
+
+	split_policy policy;
+	int sequential_inserts;
 
 public:
-	BTree(int max_node_degree = 3)
+	BTree(int max_node_degree = 3, split_policy policy = split_policy::balanced)
 	{
 		if (max_node_degree < 3)
 			throw("BTree max node degree cannot be less than 3!");
@@ -67,13 +258,23 @@ public:
 		this->max_node_data_length = max_node_degree-1;
 		this->max_node_degree = max_node_degree;
 		this->min_node_data_length = (max_node_data_length)/2;
+		this->structure_version = 0;
+		this->rightmost_version = 0;
+		this->policy = policy;
+		this->sequential_inserts = 0;
+		this->lazy_removal = false;
+		this->max_tombstones = 64;
+		this->write_buffer_capacity = 0;
+		this->leaf_filters = false;
+		this->reclaimer = nullptr;
 	}
-	BTree(const std::vector<T>& list)
+	BTree(const std::vector<T>& list) : BTree()
 	{
 		for (int i=0; i < list.size(); i++)
 			this->insert(list[i]);
 	}
 	BTree(const BTree& btree) : BTree() {*this = btree;}
+	BTree(BTree&& btree) : BTree(btree.max_node_degree, btree.policy) {*this = std::move(btree);}
 	virtual ~BTree()
 	{
 		this->clear();
@@ -81,61 +282,129 @@ public:
 	}
 
 	void insert(T data);//ok1
+	const_iterator insert(const_iterator hint, T data);
 	void insert_multiple(const std::vector<T>& list);
 	void remove(T data);//ok1
 	void remove_multiple(const std::vector<T>& list);
+	void erase_range(const T& low, const T& high);
+	BTree extract_range(const T& low, const T& high);
+
+	BTree split_at(const T& key);
+	void join(BTree&& rhs);
+
+	BTree set_union(const BTree& rhs) const;
+	BTree set_intersection(const BTree& rhs) const;
+	BTree set_difference(const BTree& rhs) const;
+	void merge_into(BTree& target) const;
+
+	void compact(int fill = 0, int buffer_length = 4096);
+	void shrink_to_fit();
 
 	void clear();
 
 	Node* search(T data) const;
+	bool contains(const T& data) const;
+	const_iterator find(const T& data) const;
+	const_iterator find_from(const_iterator hint, T data) const;
+	const_iterator lower_bound(const T& data) const;
+#ifdef BTREE_COROUTINES
+	template <class P>
+	LookupTask co_search(T data, P& provider) const;
+#endif
+
+	const_iterator begin() const;
+	const_iterator end() const;
 
 	bool is_empty() const;
 	bool is_full() const;
+	memory_report memory_usage() const;
+
+	void set_split_policy(split_policy policy);
+	split_policy get_split_policy() const;
+
+	void set_lazy_removal(bool enabled, int max_tombstones = 64);
+	int purge_tombstones(int max_count = -1);
+	int tombstone_count() const;
+
+	void set_write_buffer(int capacity);
+	void flush_write_buffer();
+
+	void set_leaf_filters(bool enabled);
+	bool has_leaf_filters() const;
+
+	void set_reclaimer(EpochReclaimer *reclaimer);
 
-	void inorder_display() const;
-	void levelorder_display() const;
+#ifdef BTREE_INSTRUMENTATION
+	BTreeInstrumentation& get_instrumentation() const;
+#endif
+
+	template <class F>
+	void for_each_inorder(F function) const;
+	template <class F>
+	void for_each_level(F function) const;
+	template <class F>
+	void visit_nodes(F function) const;
+
+	template <class F>
+	void parallel_for_each(F function, int thread_count = 0) const;
+	template <class R, class Op>
+	R reduce(R identity, Op op, int thread_count = 0) const;
+	template <class P>
+	int count_if(P predicate, int thread_count = 0) const;
+	template <class P>
+	std::vector<T> filter_to_vector(P predicate, int thread_count = 0) const;
+
+	void inorder_display(std::ostream& out = std::cout) const;
+	void levelorder_display(std::ostream& out = std::cout) const;
 
 	BTree& operator=(const BTree& rhs);
+	BTree& operator=(BTree&& rhs);
 
 	void copy_to(BTree& rhs);
+
+	FrozenBTree<T> freeze() const;
 };
 
 //Node functions start
+//Returns false without inserting if data is already in the node
 template <class T>
-void BTree<T>::Node::insert_to_node(T data, int max_node_data_length)
+bool BTree<T>::Node::insert_to_node(T data, int max_node_data_length)
 {
 	//Insertion
 	if (this->node_data.length() == 0)
 	{
 		this->node_data.insert_at(data, 0);
-		return;
+		return true;
 	}
 	
 
-	typename LinkedList<T>::Node* temp = this->node_data.get_index(0);
-	
-	for (int i=0; i < this->node_data.length(); i++)
+	if (this->node_data.get_tail()->get_data() < data)//biggest element case
+		this->node_data.push_back(data);
+	else
 	{
-		if (data < temp->get_data())
+		typename LinkedList<T>::Node* temp = this->node_data.get_index(0);
+		typename LinkedList<T>::Node* follower = nullptr;
+
+		while (temp != nullptr && !(data < temp->get_data()))
 		{
-			this->node_data.insert_at(data, i);
-			break;
+			follower = temp;
+			temp = temp->get_next();
 		}
-		temp = temp->get_next();
+		if (follower != nullptr && follower->get_data() == data)
+			return false;
+		this->node_data.insert_after_unchecked(data, follower);
 	}
 
-	if (temp == nullptr)//biggest element case
-		this->node_data.insert_at(data, this->node_data.length());
-
 	//Node Situation Update
 	if (this->node_data.length() > max_node_data_length)
 		this->situation = node_situation::overloaded;
 	else if (this->node_data.length() >= (max_node_data_length)/2)
 		this->situation = node_situation::normal;
+	return true;
 }
 
 template <class T>
-T BTree<T>::Node::remove_from_node(int index, int min_node_data_length)
+T BTree<T>::Node::remove_from_node(int index, int min_node_data_length, const BTree& tree)
 {
 	if (this->node_data.length() == 0)
 		throw("Empty node cannot remove any element!");
@@ -147,10 +416,21 @@ T BTree<T>::Node::remove_from_node(int index, int min_node_data_length)
 	if (this->node_data.length() < min_node_data_length)
 		this->situation = node_situation::empty;
 
-	delete temp;
+	tree.release_cell(temp);
 	return data;
 }
 
+template <class T>
+void BTree<T>::Node::update_situation(int max_node_data_length)
+{
+	if (this->node_data.length() > max_node_data_length)
+		this->situation = node_situation::overloaded;
+	else if (this->node_data.length() >= (max_node_data_length)/2)
+		this->situation = node_situation::normal;
+	else
+		this->situation = node_situation::empty;
+}
+
 template <class T>
 bool BTree<T>::Node::is_leaf() const
 {
@@ -165,6 +445,7 @@ typename BTree<T>::Node& BTree<T>::Node::operator=(const BTree<T>::Node& rhs)
 		this->node_data = rhs.node_data;
 		this->children.clear();
 		this->situation = rhs.situation;
+		this->filter = rhs.filter;
 	}
 	return *this;
 }
@@ -173,9 +454,9 @@ typename BTree<T>::Node& BTree<T>::Node::operator=(const BTree<T>::Node& rhs)
 
 //Tree functions start
 template <class T>
-typename BTree<T>::Node* BTree<T>::search_with_path(T data, int& index, Stack<Node*>& path)
+typename BTree<T>::Node* BTree<T>::search_with_path(T data, int& index, ArrayStack<Node*>& path)
 {
-	if (this->is_empty())
+	if (this->root == nullptr)
 		return nullptr;
 
 	Node* tracker = this->root;
@@ -227,9 +508,9 @@ typename BTree<T>::Node* BTree<T>::search_with_path(T data, int& index, Stack<No
 }
 
 template <class T>
-typename BTree<T>::Node* BTree<T>::place_to_insert(T data, int& index, Stack<Node*>& path)
+typename BTree<T>::Node* BTree<T>::place_to_insert(T data, int& index, ArrayStack<Node*>& path)
 {
-	if (this->is_empty())
+	if (this->root == nullptr)
 	{
 		this->root = new Node;
 		return this->root;
@@ -290,7 +571,7 @@ typename BTree<T>::Node* BTree<T>::place_to_insert(T data, int& index, Stack<Nod
 }
 
 template <class T>
-typename BTree<T>::Node* BTree<T>::pre_inorder(Node *start, int& index, Stack<Node*>& path)
+typename BTree<T>::Node* BTree<T>::pre_inorder(Node *start, int& index, ArrayStack<Node*>& path)
 {
 	if (start == nullptr)
 		throw("nullptr has no presuccessive inorder!");
@@ -303,15 +584,15 @@ typename BTree<T>::Node* BTree<T>::pre_inorder(Node *start, int& index, Stack<No
 	while (!temp->is_leaf())
 	{
 		path.push(temp);
-		temp = temp->children.get_index(temp->children.length()-1)->get_data();
+		temp = temp->children.get_tail()->get_data();
 	}
 	return temp;
 }
 
 template <class T>
-typename BTree<T>::Node* BTree<T>::search_with_path_and_index(T data, int& index, Stack<typename BTree<T>::Node*>& path, Stack<typename BTree<T>::Node*>& path_left, Stack<typename BTree<T>::Node*>& path_right, Stack<int>& indices)
+typename BTree<T>::Node* BTree<T>::search_with_path_and_index(T data, int& index, ArrayStack<typename BTree<T>::Node*>& path, ArrayStack<typename BTree<T>::Node*>& path_left, ArrayStack<typename BTree<T>::Node*>& path_right, ArrayStack<int>& indices)
 {
-	if (this->is_empty())
+	if (this->root == nullptr)
 	{
 		this->root = new Node;
 		return this->root;
@@ -414,7 +695,7 @@ typename BTree<T>::Node* BTree<T>::search_with_path_and_index(T data, int& index
 }
 
 template <class T>
-typename BTree<T>::Node* BTree<T>::pre_inorder_with_index(Node *start, int& index, Stack<typename BTree<T>::Node*>& path, Stack<typename BTree<T>::Node*>& path_left, Stack<typename BTree<T>::Node*>& path_right, Stack<int>& indices)
+typename BTree<T>::Node* BTree<T>::pre_inorder_with_index(Node *start, int& index, ArrayStack<typename BTree<T>::Node*>& path, ArrayStack<typename BTree<T>::Node*>& path_left, ArrayStack<typename BTree<T>::Node*>& path_right, ArrayStack<int>& indices)
 {
 	if (start == nullptr)
 		throw("nullptr has no presuccessive inorder!");
@@ -474,23 +755,19 @@ typename BTree<T>::Node* BTree<T>::pre_inorder_with_index(Node *start, int& inde
 }
 
 template <class T>
-void BTree<T>::split(Node* node, Node* parent)
+void BTree<T>::split(Node* node, Node* parent, bool right_edge)
 {
 	//std::cout << "Split the node that last insertion happened." << std::endl;
+	BTREE_TRACE(split);
+	this->structure_version++;
 	int just_behind_middle = (node->node_data.length()-1)/2;
 
-	Node *creater = new Node;
-
-	typename LinkedList<T>::Node* tracker_data = node->node_data.get_index(0);
-	typename LinkedList<Node*>::Node* tracker_children = nullptr;
-
-	T temp;
-	Node* temp2;
+	//Only the biggest element goes to the new node, the second biggest goes up.
+	//New node stays under minimum size until following appends fill it.
+	if (right_edge)
+		just_behind_middle = node->node_data.length()-2;
 
-	Stack<T> data_placement_storage;
-	Stack<T> data_placement_storage2;
-	Stack<Node*> children_storage;
-	Stack<Node*> children_storage2;
+	Node *creater = new Node;
 
 	if (parent == nullptr)
 	{
@@ -500,82 +777,32 @@ void BTree<T>::split(Node* node, Node* parent)
 		this->root = parent;
 	}
 
-	for (int i=0; i < just_behind_middle; i++)
-	{
-		temp = tracker_data->get_data();
-		data_placement_storage.push(temp);
-		tracker_data = tracker_data->get_next();
-	}
-
-	temp = tracker_data->get_data();
-	parent->insert_to_node(temp, this->max_node_data_length);
-	tracker_data = tracker_data->get_next();
+	//Runs behind the middle are moved as a whole, middle element goes up to the parent
+	node->node_data.split_at(just_behind_middle, creater->node_data);
+	T middle = creater->node_data.get_index(0)->get_data();
+	this->remove_cell(creater->node_data, 0);
 
-	for (int i=just_behind_middle+1; i < node->node_data.length(); i++)
-	{
-		temp = tracker_data->get_data();
-		data_placement_storage2.push(temp);
-		tracker_data = tracker_data->get_next();
-	}
 	if (!node->is_leaf())
-	{
-		int middle = (node->children.length())/2;
-		tracker_children = node->children.get_index(0);
-
-		for (int i=0; i < middle; i++)
-		{
-			temp2 = tracker_children->get_data();
-			children_storage.push(temp2);
-			tracker_children = tracker_children->get_next();
-		}
-		for (int i=middle; i < node->children.length(); i++)
-		{
-			temp2 = tracker_children->get_data();
-			children_storage2.push(temp2);
-			tracker_children = tracker_children->get_next();
-		}
-	}
-
-	//std::cout << "Clear all the elements in the splitted node." << std::endl;
-	node->node_data.clear(); node->children.clear();
+		node->children.split_at(just_behind_middle+1, creater->children);
 
-	while(!data_placement_storage.is_empty())
-	{
-		temp = data_placement_storage.pop();
-		//std::cout << "Add " << temp << " to the beginning of the first node." << std::endl;
-		node->insert_to_node(temp, this->max_node_data_length);
-	}
-	while (!children_storage.is_empty())
-	{
-		temp2 = children_storage.pop();
-		node->children.insert_at(temp2, 0);
-	}
-	while (!data_placement_storage2.is_empty())
-	{
-		temp = data_placement_storage2.pop();
-		//std::cout << "Add " << temp << " to the beginning of the second node." << std::endl;
-		creater->insert_to_node(temp, this->max_node_data_length);
-	}
-	while (!children_storage2.is_empty())
-	{
-		temp2 = children_storage2.pop();
-		creater->children.insert_at(temp2, 0);
-	}
+	node->update_situation(this->max_node_data_length);
+	creater->update_situation(this->max_node_data_length);
+	this->rebuild_filter(node);
+	this->rebuild_filter(creater);
+	parent->insert_to_node(middle, this->max_node_data_length);
 
-
-	tracker_children = parent->children.get_index(0);
+	typename LinkedList<Node*>::Node* tracker_children = parent->children.get_index(0);
 	for (int i=0; i < parent->children.length(); i++)
 	{
 		if (tracker_children->get_data() == node)
 		{
-			parent->children.insert_at(creater, i+1);
+			parent->children.insert_after_unchecked(creater, tracker_children);
 			break;
 		}
 		tracker_children = tracker_children->get_next();
 	}
 }
 
-
 template <class T>
 bool BTree<T>::can_borrow(Node *borrower, Node *sharer) const
 {
@@ -596,16 +823,17 @@ template <class T>
 void BTree<T>::borrow_from_left(typename BTree<T>::Node* borrower, typename BTree<T>::Node* sharer, typename BTree<T>::Node* parent, int index)
 {
 	
-	T temp2 = sharer->remove_from_node(sharer->node_data.length()-1, this->min_node_data_length);
+	T temp2 = sharer->remove_from_node(sharer->node_data.length()-1, this->min_node_data_length, *this);
 	parent->insert_to_node(temp2, this->max_node_data_length);
-	T temp = parent->remove_from_node(index, this->min_node_data_length);
+	T temp = parent->remove_from_node(index, this->min_node_data_length, *this);
 	borrower->insert_to_node(temp, this->max_node_data_length);
+	this->add_to_filter(borrower, temp);
 
 	if (!sharer->is_leaf())
 	{
 		typename LinkedList<Node*>::Node* temp = sharer->children.extract_node_at(sharer->children.length()-1);
 		Node* value = temp->get_data();
-		delete temp;
+		this->release_cell(temp);
 		borrower->children.insert_at(value, 0);
 	}
 }
@@ -613,185 +841,168 @@ void BTree<T>::borrow_from_left(typename BTree<T>::Node* borrower, typename BTre
 template <class T>
 void BTree<T>::borrow_from_right(typename BTree<T>::Node* borrower, typename BTree<T>::Node* sharer, typename BTree<T>::Node* parent, int index)
 {
-	T temp2 = sharer->remove_from_node(0, this->min_node_data_length);
+	T temp2 = sharer->remove_from_node(0, this->min_node_data_length, *this);
 	parent->insert_to_node(temp2, this->max_node_data_length);
-	T temp = parent->remove_from_node(index, this->min_node_data_length);
+	T temp = parent->remove_from_node(index, this->min_node_data_length, *this);
 	borrower->insert_to_node(temp, this->max_node_data_length);
+	this->add_to_filter(borrower, temp);
 
 	if (!sharer->is_leaf())
 	{
 		typename LinkedList<Node*>::Node* temp = sharer->children.extract_node_at(0);
 		Node* value = temp->get_data();
-		delete temp;
-		borrower->children.insert_at(value, borrower->children.length());
+		this->release_cell(temp);
+		borrower->children.push_back(value);
 	}
 }
 
 template <class T>
 void BTree<T>::merge_left(typename BTree<T>::Node* deficient, typename BTree<T>::Node* left_sibling, typename BTree<T>::Node* parent, int index)
 {
-	Stack<T> data_order;
-	Stack<Node*> children_order;
-
-	typename LinkedList<T>::Node* tracker_data = left_sibling->node_data.get_index(0);
-	typename LinkedList<Node*>::Node* tracker_children = nullptr;
-
 	//std::cout << "LEFT MERGE VIA PARENT " << parent->node_data.get_index(0)->get_data() << " AND SIBLING " << left_sibling->node_data.get_index(0)->get_data();
 
-	T temp;
-	Node* temp2;
-
-	for (int i=0; i < left_sibling->node_data.length(); i++)
-	{
-		data_order.push(tracker_data->get_data());
-		tracker_data = tracker_data->get_next();
-	}
-
-	data_order.push(parent->remove_from_node(index-1, this->min_node_data_length));
-
-	if (deficient->node_data.length() != 0)
-	{
-		tracker_data = deficient->node_data.get_index(0);
-		for (int i=0; i < deficient->node_data.length(); i++)
-		{
-			data_order.push(tracker_data->get_data());
-			tracker_data = tracker_data->get_next();
-		}
-	}
-
-	if (!left_sibling->is_leaf())
-	{
-		tracker_children = left_sibling->children.get_index(0);
-		for (int i=0; i < left_sibling->children.length(); i++)
-		{
-			children_order.push(tracker_children->get_data());
-			tracker_children = tracker_children->get_next();
-		}
-	}
-	if (!deficient->is_leaf())
-	{
-		tracker_children = deficient->children.get_index(0);
-		for (int i=0; i < deficient->children.length(); i++)
-		{
-			children_order.push(tracker_children->get_data());
-			tracker_children = tracker_children->get_next();
-		}
-	}
-
-	parent->children.remove_at(index);//deficient is deleted
-	left_sibling->node_data.clear();
-	left_sibling->children.clear();
-
-	while (!data_order.is_empty())
-	{
-		temp = data_order.pop();
-		left_sibling->insert_to_node(temp, this->max_node_data_length);
-	}
-	while (!children_order.is_empty())
-	{
-		temp2 = children_order.pop();
-		left_sibling->children.insert_at(temp2, 0);
-	}
+	//left sibling + separator + deficient, lists are linked to each other instead of copied
+	BTREE_TRACE(merge);
+	left_sibling->node_data.push_back(parent->remove_from_node(index-1, this->min_node_data_length, *this));
+	this->add_to_filter(left_sibling, left_sibling->node_data.get_tail()->get_data());
+	this->merge_filter(left_sibling, deficient);
+	left_sibling->node_data.splice_back(deficient->node_data);
+	left_sibling->children.splice_back(deficient->children);
+	left_sibling->update_situation(this->max_node_data_length);
+
+	this->remove_cell(parent->children, index);//deficient is deleted
+	this->release_node(deficient);
 }
 
 template <class T>
 void BTree<T>::merge_right(typename BTree<T>::Node* deficient, typename BTree<T>::Node* right_sibling, typename BTree<T>::Node* parent, int index)
 {
-	Stack<T> data_order;
-	Stack<Node*> children_order;
-
-	typename LinkedList<T>::Node* tracker_data = nullptr;
-	typename LinkedList<Node*>::Node* tracker_children = nullptr;
-
-	T temp;
-	Node* temp2;
-
 	//std::cout << "RIGHT MERGE VIA PARENT " << parent->node_data.get_index(0)->get_data() << " AND SIBLING " << right_sibling->node_data.get_index(0)->get_data();
 
-	if (deficient->node_data.length() != 0)
-	{
-		tracker_data = deficient->node_data.get_index(0);
-		for (int i=0; i < deficient->node_data.length(); i++)
-		{
-			data_order.push(tracker_data->get_data());
-			tracker_data = tracker_data->get_next();
-		}
-	}
-
-	data_order.push(parent->remove_from_node(index, this->min_node_data_length));
-
-	tracker_data = right_sibling->node_data.get_index(0);
-	for (int i=0; i < right_sibling->node_data.length(); i++)
-	{
-		data_order.push(tracker_data->get_data());
-		tracker_data = tracker_data->get_next();
-	}
-
-	if (!deficient->is_leaf())
-	{
-		tracker_children = deficient->children.get_index(0);
-		for (int i=0; i < deficient->children.length(); i++)
-		{
-			children_order.push(tracker_children->get_data());
-			tracker_children = tracker_children->get_next();
-		}
-	}
-
-	if (!right_sibling->is_leaf())
-	{
-		tracker_children = right_sibling->children.get_index(0);
-		for (int i=0; i < right_sibling->children.length(); i++)
-		{
-			children_order.push(tracker_children->get_data());
-			tracker_children = tracker_children->get_next();
-		}
-	}
-
-	parent->children.remove_at(index);//deficient is deleted
-	right_sibling->node_data.clear();
-	right_sibling->children.clear();
-
-	while (!data_order.is_empty())
-	{
-		temp = data_order.pop();
-		right_sibling->insert_to_node(temp, this->max_node_data_length);
-	}
-	while (!children_order.is_empty())
-	{
-		temp2 = children_order.pop();
-		right_sibling->children.insert_at(temp2, 0);
-	}
+	//deficient + separator + right sibling, lists are linked to each other instead of copied
+	BTREE_TRACE(merge);
+	deficient->node_data.push_back(parent->remove_from_node(index, this->min_node_data_length, *this));
+	this->add_to_filter(right_sibling, deficient->node_data.get_tail()->get_data());
+	this->merge_filter(right_sibling, deficient);
+	right_sibling->node_data.splice_front(deficient->node_data);
+	right_sibling->children.splice_front(deficient->children);
+	right_sibling->update_situation(this->max_node_data_length);
+
+	this->remove_cell(parent->children, index);//deficient is deleted
+	this->release_node(deficient);
 }
 
-
 template <class T>
 void BTree<T>::insert(T data)
+{
+	BTREE_OPERATION(insert);
+	if (this->write_buffer_capacity > 0)
+		return this->buffer_message(data, false);
+	this->insert_into_tree(data);
+}
+
+template <class T>
+void BTree<T>::insert_into_tree(T data)
 {
 	//std::cout << "Inserting " << data << ":" << std::endl;
-	if (this->is_empty())
+	if (this->revive(data))
+		return;
+
+	if (this->root == nullptr)
 	{
 		//std::cout << "Create a root node and put " << data << " in it." << std::endl;
 		this->root = new Node;
 		this->root->insert_to_node(data, this->max_node_data_length);
+		this->rebuild_filter(this->root);
+		this->structure_version++;
 		//std::cout << "Done!" << std::endl << std::endl;
 		return;
 	}
 
 	int index = -1;
-	Stack<Node*> path;
+	ArrayStack<Node*> path;
 	path.push(nullptr);
 
+	//Appending after the biggest element needs no descent (monotonic keys)
+	if (this->rightmost_version != this->structure_version)
+		this->refresh_rightmost_path();
+
+	Node *rightmost = this->rightmost_path.back();
+	if (rightmost->node_data.get_tail()->get_data() < data)
+	{
+		for (int i=0; i < (int)this->rightmost_path.size(); i++)
+			path.push(this->rightmost_path[i]);
+		rightmost->insert_to_node(data, this->max_node_data_length);
+		this->add_to_filter(rightmost, data);
+
+		this->sequential_inserts++;
+		bool right_edge = this->policy == split_policy::right_edge
+			|| (this->policy == split_policy::automatic && this->sequential_inserts > 1);
+		this->split_upwards(path, right_edge);
+		return;
+	}
+
+	this->sequential_inserts = 0;
 	Node *tracker = this->place_to_insert(data, index, path);
-	Node *temp, *temp2;
 
 	if (tracker == nullptr)
 	{
 		//std::cout << "Element was already inserted!" << std::endl;
 		//std::cout << "Done!" << std::endl << std::endl;
+		return;
 	}
 
 	//std::cout << "It will be inserted to the node with given beginning data: " << tracker->node_data.get_index(0)->get_data() << std::endl;
 	tracker->insert_to_node(data, this->max_node_data_length);
+	this->add_to_filter(tracker, data);
+	this->split_upwards(path);
+	//std::cout << "Done!" << std::endl << std::endl;
+}
+
+template <class T>
+typename BTree<T>::const_iterator BTree<T>::insert(const_iterator hint, T data)
+{
+	BTREE_OPERATION(insert);
+	this->flush_write_buffer();
+
+	if (this->root == nullptr)
+	{
+		this->insert_into_tree(data);
+		return this->begin();
+	}
+	if (this->revive(data))
+		return this->find_from(hint, data);
+
+	const_iterator position(this);
+	if (this->locate_from(hint, data, position))
+		return position;
+
+	Node *leaf = position.nodes.back();
+	int index = position.indices.back();
+
+	leaf->insert_to_node(data, this->max_node_data_length);
+	this->add_to_filter(leaf, data);
+
+	if (leaf->situation != Node::node_situation::overloaded)
+	{
+		position.current = leaf->node_data.get_index(index);
+		return position;
+	}
+
+	ArrayStack<Node*> path;
+	path.push(nullptr);
+	for (int i=0; i < (int)position.nodes.size(); i++)
+		path.push(position.nodes[i]);
+	this->split_upwards(path);
+
+	//Split moved the data to another node, so it's looked up again
+	return this->find_from(const_iterator(), data);
+}
+
+template <class T>
+void BTree<T>::split_upwards(ArrayStack<Node*>& path, bool right_edge)
+{
+	Node *temp, *temp2;
 
 	while (path.top() != nullptr)
 	{
@@ -799,11 +1010,10 @@ void BTree<T>::insert(T data)
 		temp2 = path.top();
 
 		if (temp->situation == Node::node_situation::overloaded)
-			this->split(temp, temp2);
+			this->split(temp, temp2, right_edge);
 		else
 			break;
 	}
-	//std::cout << "Done!" << std::endl << std::endl;
 }
 
 template <class T>
@@ -816,15 +1026,38 @@ void BTree<T>::insert_multiple(const std::vector<T>& list)
 template <class T>
 void BTree<T>::remove(T data)
 {
-	if (this->is_empty())
+	BTREE_OPERATION(remove);
+	if (this->write_buffer_capacity > 0)
+		return this->buffer_message(data, true);
+	this->apply_removal(data);
+}
+
+template <class T>
+void BTree<T>::apply_removal(T data)
+{
+	if (!this->lazy_removal)
+		return this->remove_from_tree(data);
+
+	if (this->find_node(data) == nullptr || !this->tombstones.insert(data).second)
+		return;
+
+	if ((int)this->tombstones.size() >= this->max_tombstones)
+		this->purge_tombstones(purge_step);
+}
+
+template <class T>
+void BTree<T>::remove_from_tree(T data)
+{
+	//Absent data costs only a read only descent, path stacks are built when there's something to remove
+	if (this->find_node(data) == nullptr)
 		return;
 
 	////std::cout << "Removing " << data << " has started!" << std::endl;
 
-	Stack<Node*> path;
-	Stack<Node*> path_left;
-	Stack<Node*> path_right;
-	Stack<int> indices;
+	ArrayStack<Node*> path;
+	ArrayStack<Node*> path_left;
+	ArrayStack<Node*> path_right;
+	ArrayStack<int> indices;
 
 	path.push(nullptr);
 	path.push(this->root);
@@ -840,6 +1073,7 @@ void BTree<T>::remove(T data)
 	if (tracker == nullptr)
 		return;
 
+	this->structure_version++;
 	////std::cout << "Data is on " << tracker->node_data.get_index(0)->get_data() << std::endl;
 	Node *temp = tracker, *temp2 = nullptr;
 
@@ -851,13 +1085,19 @@ void BTree<T>::remove(T data)
 	if (temp2 == nullptr)
 		return;
 
-	T successor = temp2->node_data.get_index(index)->get_data();
-	////std::cout << "Its preorder successor is " << successor << std::endl;
+	//Data on a leaf is removed directly, otherwise it's replaced with its inorder predecessor
+	if (temp2 == temp)
+		temp->remove_from_node(found_index, this->min_node_data_length, *this);
+	else
+	{
+		T successor = temp2->node_data.get_index(index)->get_data();
+		////std::cout << "Its preorder successor is " << successor << std::endl;
 
-	////std::cout << "Replacing data with preorder successor happens:" << std::endl;
-	temp->remove_from_node(found_index, this->min_node_data_length);
-	temp->insert_to_node(successor, this->max_node_data_length);
-	temp2->remove_from_node(index, this->min_node_data_length);
+		////std::cout << "Replacing data with preorder successor happens:" << std::endl;
+		temp->remove_from_node(found_index, this->min_node_data_length, *this);
+		temp->insert_to_node(successor, this->max_node_data_length);
+		temp2->remove_from_node(index, this->min_node_data_length, *this);
+	}
 
 	Node *temp_left = nullptr, *temp_right = nullptr;
 
@@ -903,13 +1143,19 @@ void BTree<T>::remove(T data)
 				this->merge_right(temp, temp_right, temp2, index);
 			else if (temp_left != nullptr)
 				this->merge_left(temp, temp_left, temp2, index);
-			else
+			else if (temp->node_data.length() == 0)
 			{
+				//Root is allowed to be under minimum, it's replaced only when it runs out of elements
 				temp = this->root;
-				this->root = this->root->children.get_index(0)->get_data();
-				delete temp;
+				if (temp->is_leaf())
+					this->root = nullptr;
+				else
+					this->root = this->root->children.get_index(0)->get_data();
+				this->release_node(temp);
 				return;
 			}
+			else
+				break;
 		}
 		else
 			break;
@@ -923,99 +1169,1278 @@ void BTree<T>::remove_multiple(const std::vector<T>& list)
 		this->remove(list[i]);
 }
 
+//Elements not less than low and less than high are removed
 template <class T>
-void BTree<T>::clear()
+void BTree<T>::erase_range(const T& low, const T& high)
 {
-	if (this->is_empty())
-		return;
+	BTree removed = this->extract_range(low, high);
+}
 
-	Queue<Node*> remover;
-	Node* temp = nullptr;
-	typename LinkedList<Node*>::Node* children_tracker = nullptr;
-	remover.enqueue(this->root);
+//Cuts the range out as a whole: tree is split at both ends and the outer parts are joined back
+template <class T>
+BTree<T> BTree<T>::extract_range(const T& low, const T& high)
+{
+	BTree extracted(this->max_node_degree);
+	extracted.copy_configuration(*this);
+	if (!(low < high))
+		return extracted;
+
+	BTree right(this->max_node_degree);
+	right.copy_configuration(*this);
+	this->split_tree(low, extracted);
+	extracted.split_tree(high, right);
+	this->join_tree(right);
+	return extracted;
+}
 
-	while (!remover.is_empty())
+template <class T>
+int BTree<T>::node_height(Node *node) const
+{
+	if (node == nullptr)
+		return -1;
+
+	int height = 0;
+	while (!node->is_leaf())
 	{
-		temp = remover.dequeue();
-		if (!temp->is_leaf())
-		{
-			children_tracker = temp->children.get_index(0);
-			for (int i=0; i < temp->children.length(); i++)
-			{
-				remover.enqueue(children_tracker->get_data());
-				children_tracker = children_tracker->get_next();
-			}
-		}
-		delete temp;
+		node = node->children.get_index(0)->get_data();
+		height++;
 	}
-	this->root = nullptr;
+	return height;
 }
 
+//A root left without elements is replaced by its only child (or nothing)
 template <class T>
-typename BTree<T>::Node* BTree<T>::search(T data) const
+void BTree<T>::trim_root(Node*& node, int& height)
 {
-	if (this->is_empty())
-		return nullptr;
-
-	Node* tracker = this->root;
-	typename LinkedList<T>::Node* tracker_node_data = nullptr;
+	if (node == nullptr || !node->node_data.is_empty())
+		return;
 
-	while (tracker != nullptr)
+	Node *temp = node;
+	if (node->is_leaf())
 	{
-		tracker_node_data = tracker->node_data.get_index(0);
-		if (!tracker->is_leaf())
-		{
-			for (int i=0; i < tracker->node_data.length(); i++)
-			{
-				if (data < tracker_node_data->get_data())
-				{
-					tracker = tracker->children.get_index(i)->get_data();
-					break;
-				}
-				else if (data == tracker_node_data->get_data())
-					return tracker;
+		node = nullptr;
+		height = -1;
+	}
+	else
+	{
+		node = node->children.get_index(0)->get_data();
+		height--;
+	}
+	this->release_node(temp);
+}
 
-				tracker_node_data = tracker_node_data->get_next();
-			}
-			tracker = tracker->children.get_index(tracker->children.length()-1)->get_data();
+//left < separator < right, only their roots may be under minimum size.
+//The shorter tree is concatenated to the node of same height on the facing edge of the
+//taller one, then overloaded nodes are split up to the root. this->root is the new root.
+template <class T>
+typename BTree<T>::Node* BTree<T>::join_roots(Node *left, int left_height, const T& separator, Node *right, int right_height, int& height)
+{
+	if (left == nullptr)
+	{
+		left = new Node;
+		left_height = 0;
+	}
+	if (right == nullptr)
+	{
+		right = new Node;
+		right_height = 0;
+	}
+
+	ArrayStack<Node*> path;
+	path.push(nullptr);
+	Node *tracker = nullptr;
+
+	if (left_height >= right_height)
+	{
+		this->root = tracker = left;
+		path.push(tracker);
+		for (height = left_height; height > right_height; height--)
+		{
+			tracker = tracker->children.get_tail()->get_data();
+			path.push(tracker);
+		}
+
+		tracker->node_data.push_back(separator);
+		this->add_to_filter(tracker, separator);
+		this->merge_filter(tracker, right);
+		tracker->node_data.splice_back(right->node_data);
+		tracker->children.splice_back(right->children);
+		this->release_node(right);
+		height = left_height;
+	}
+	else
+	{
+		this->root = tracker = right;
+		path.push(tracker);
+		for (height = right_height; height > left_height; height--)
+		{
+			tracker = tracker->children.get_index(0)->get_data();
+			path.push(tracker);
+		}
+
+		tracker->node_data.insert_at(separator, 0);
+		this->add_to_filter(tracker, separator);
+		this->merge_filter(tracker, left);
+		tracker->node_data.splice_front(left->node_data);
+		tracker->children.splice_front(left->children);
+		this->release_node(left);
+		height = right_height;
+	}
+
+	tracker->update_situation(this->max_node_data_length);
+	this->rebuild_filter(tracker);
+	Node *old_root = this->root;
+	this->split_upwards(path);
+	if (this->root != old_root)
+		height++;
+
+	this->structure_version++;
+	return this->root;
+}
+
+//left gets the elements less than key, right gets the rest.
+//Every node on the way down is cut in two around the child containing key,
+//and the cut pieces are joined back with the results coming from below.
+template <class T>
+void BTree<T>::split_subtree(Node *node, int height, const T& key, Node*& left, int& left_height, Node*& right, int& right_height)
+{
+	int index = 0;
+	typename LinkedList<T>::Node* tracker_data = node->node_data.get_index(0);
+	while (tracker_data != nullptr && tracker_data->get_data() < key)
+	{
+		tracker_data = tracker_data->get_next();
+		index++;
+	}
+	bool found = tracker_data != nullptr && tracker_data->get_data() == key;
+
+	Node *rest = new Node;
+	node->node_data.split_at(index, rest->node_data);
+
+	if (node->is_leaf())
+	{
+		left = node;
+		right = rest;
+		left_height = right_height = 0;
+		left->update_situation(this->max_node_data_length);
+		right->update_situation(this->max_node_data_length);
+		this->rebuild_filter(left);
+		this->rebuild_filter(right);
+		this->trim_root(left, left_height);
+		this->trim_root(right, right_height);
+		return;
+	}
+
+	node->children.split_at(index, rest->children);
+	Node *middle = rest->children.get_index(0)->get_data();
+	this->remove_cell(rest->children, 0);
+
+	Node *middle_left = nullptr, *middle_right = nullptr;
+	int middle_left_height = -1, middle_right_height = -1;
+
+	//Key itself is in this node, so the child on its left is completely less than key
+	if (found)
+	{
+		middle_left = middle;
+		middle_left_height = height-1;
+	}
+	else
+		this->split_subtree(middle, height-1, key, middle_left, middle_left_height, middle_right, middle_right_height);
+
+	if (index == 0)
+	{
+		this->release_node(node);
+		left = middle_left;
+		left_height = middle_left_height;
+	}
+	else
+	{
+		T separator = node->node_data.get_tail()->get_data();
+		this->remove_cell(node->node_data, node->node_data.length()-1);
+		node->update_situation(this->max_node_data_length);
+
+		int node_height = height;
+		this->trim_root(node, node_height);
+		left = this->join_roots(node, node_height, separator, middle_left, middle_left_height, left_height);
+	}
+
+	if (rest->node_data.is_empty())
+	{
+		this->release_node(rest);
+		right = middle_right;
+		right_height = middle_right_height;
+	}
+	else
+	{
+		T separator = rest->node_data.get_index(0)->get_data();
+		this->remove_cell(rest->node_data, 0);
+		rest->update_situation(this->max_node_data_length);
+
+		int rest_height = height;
+		this->trim_root(rest, rest_height);
+		right = this->join_roots(middle_right, middle_right_height, separator, rest, rest_height, right_height);
+	}
+}
+
+//Moves the elements not less than key to right, which must be empty
+template <class T>
+void BTree<T>::split_tree(const T& key, BTree& right)
+{
+	this->settle();
+	if (this->root == nullptr)
+		return;
+
+	Node *left_root = nullptr, *right_root = nullptr;
+	int left_height, right_height;
+	this->split_subtree(this->root, this->node_height(this->root), key, left_root, left_height, right_root, right_height);
+
+	this->root = left_root;
+	right.root = right_root;
+	this->structure_version++;
+	right.structure_version++;
+}
+
+//Moves all elements of right, which must be greater than the elements of this, to this
+template <class T>
+void BTree<T>::join_tree(BTree& right)
+{
+	this->settle();
+	right.settle();
+	if (right.root == nullptr)
+		return;
+
+	if (this->root == nullptr)
+	{
+		this->root = right.root;
+		right.root = nullptr;
+		this->structure_version++;
+		right.structure_version++;
+		return;
+	}
+
+	//Smallest element of right becomes the separator
+	T separator = right.edge_leaf(false)->node_data.get_index(0)->get_data();
+	right.remove_from_tree(separator);
+
+	Node *right_root = right.root;
+	right.root = nullptr;
+	right.structure_version++;
+
+	int height;
+	this->join_roots(this->root, this->node_height(this->root), separator, right_root, this->node_height(right_root), height);
+}
+
+template <class T>
+typename BTree<T>::Node* BTree<T>::edge_leaf(bool rightmost) const
+{
+	Node *tracker = this->root;
+	while (!tracker->is_leaf())
+		tracker = rightmost ? tracker->children.get_tail()->get_data() : tracker->children.get_index(0)->get_data();
+	return tracker;
+}
+
+//This keeps the elements less than key, the rest are returned as a new tree
+template <class T>
+BTree<T> BTree<T>::split_at(const T& key)
+{
+	BTree right(this->max_node_degree);
+	right.copy_configuration(*this);
+	this->split_tree(key, right);
+	return right;
+}
+
+//All elements of rhs must be either greater or less than all elements of this, rhs is left empty
+template <class T>
+void BTree<T>::join(BTree&& rhs)
+{
+	if (this == &rhs)
+		throw("B-Tree cannot be joined with itself!");
+	else if (this->max_node_degree != rhs.max_node_degree)
+		throw("B-Trees with different degrees cannot be joined!");
+
+	this->settle();
+	rhs.settle();
+	if (this->root != nullptr && rhs.root != nullptr)
+	{
+		const T& smallest = this->edge_leaf(false)->node_data.get_index(0)->get_data();
+		const T& biggest = this->edge_leaf(true)->node_data.get_tail()->get_data();
+
+		//rhs comes before this, so the nodes are exchanged to join them in order
+		if (rhs.edge_leaf(true)->node_data.get_tail()->get_data() < smallest)
+		{
+			std::swap(this->root, rhs.root);
+			this->structure_version++;
+			rhs.structure_version++;
+		}
+		else if (!(biggest < rhs.edge_leaf(false)->node_data.get_index(0)->get_data()))
+			throw("Joined B-Trees must not have overlapping ranges!");
+	}
+	this->join_tree(rhs);
+}
+
+template <class T>
+void BTree<T>::build_push(bulk_builder& builder, const T& data, int level)
+{
+	if ((int)builder.open.size() == level)
+		builder.open.push_back(new Node);
+
+	Node *node = builder.open[level];
+	if (node->node_data.length() < builder.fill)
+	{
+		node->node_data.push_back(data);
+		if (node->node_data.length() == 1)
+			this->rebuild_filter(node);
+		else
+			this->add_to_filter(node, data);
+		return;
+	}
+
+	//Node is complete, data goes up as a separator and the next node of the level is opened
+	node->update_situation(this->max_node_data_length);
+	if ((int)builder.open.size() == level+1)
+	{
+		Node *parent = new Node;
+		parent->children.push_back(node);
+		builder.open.push_back(parent);
+	}
+	this->build_push(builder, data, level+1);
+
+	Node *next = new Node;
+	builder.open[level+1]->children.push_back(next);
+	builder.open[level] = next;
+}
+
+//Open nodes on the right edge may be under minimum size. From the leaves up, each open node
+//gives away its last element and last child (the open node below), which leaves a valid tree,
+//and the pieces are put together with joins. Returns the root.
+template <class T>
+typename BTree<T>::Node* BTree<T>::build_finish(bulk_builder& builder)
+{
+	Node *joined = nullptr;
+	int joined_height = -1;
+
+	for (int level=0; level < (int)builder.open.size(); level++)
+	{
+		Node *node = builder.open[level];
+		node->update_situation(this->max_node_data_length);
+
+		if (level == 0)
+		{
+			joined = node;
+			joined_height = 0;
+			this->trim_root(joined, joined_height);
+			continue;
+		}
+		else if (node->node_data.is_empty())
+		{
+			//Its only child is the open node below, which is already joined
+			this->release_node(node);
+			continue;
+		}
+
+		T separator = node->node_data.get_tail()->get_data();
+		this->remove_cell(node->node_data, node->node_data.length()-1);
+		this->remove_cell(node->children, node->children.length()-1);
+		node->update_situation(this->max_node_data_length);
+
+		int height = level;
+		this->trim_root(node, height);
+		joined = this->join_roots(node, height, separator, joined, joined_height, joined_height);
+	}
+
+	builder.open.clear();
+	return joined;
+}
+
+//keep(in_lhs, in_rhs) decides whether an element of the merged sequence goes to this
+template <class T>
+template <class P>
+void BTree<T>::build_merged(const BTree& lhs, const BTree& rhs, P keep)
+{
+	//Operands are walked by iterators, so an operand with buffered writes is merged from a flushed copy
+	if (!lhs.write_buffer.empty())
+	{
+		BTree flushed(lhs);
+		flushed.flush_write_buffer();
+		return this->build_merged(flushed, rhs, keep);
+	}
+	if (!rhs.write_buffer.empty())
+	{
+		BTree flushed(rhs);
+		flushed.flush_write_buffer();
+		return this->build_merged(lhs, flushed, keep);
+	}
+
+	bulk_builder builder;
+	builder.fill = this->max_node_data_length;
+
+	const_iterator left = lhs.begin(), left_end = lhs.end();
+	const_iterator right = rhs.begin(), right_end = rhs.end();
+
+	while (left != left_end || right != right_end)
+	{
+		//Rest of a single side is not needed
+		if ((left == left_end && !keep(false, true)) || (right == right_end && !keep(true, false)))
+			break;
+
+		if (right == right_end || (left != left_end && *left < *right))
+		{
+			if (keep(true, false))
+				this->build_push(builder, *left);
+			++left;
+		}
+		else if (left == left_end || *right < *left)
+		{
+			if (keep(false, true))
+				this->build_push(builder, *right);
+			++right;
+		}
+		else
+		{
+			if (keep(true, true))
+				this->build_push(builder, *left);
+			++left;
+			++right;
+		}
+	}
+
+	this->clear();
+	this->root = this->build_finish(builder);
+	this->structure_version++;
+}
+
+template <class T>
+BTree<T> BTree<T>::set_union(const BTree& rhs) const
+{
+	BTree result(this->max_node_degree);
+	result.copy_configuration(*this);
+	result.build_merged(*this, rhs, [](bool, bool) {return true;});
+	return result;
+}
+
+template <class T>
+BTree<T> BTree<T>::set_intersection(const BTree& rhs) const
+{
+	BTree result(this->max_node_degree);
+	result.copy_configuration(*this);
+	result.build_merged(*this, rhs, [](bool in_lhs, bool in_rhs) {return in_lhs && in_rhs;});
+	return result;
+}
+
+template <class T>
+BTree<T> BTree<T>::set_difference(const BTree& rhs) const
+{
+	BTree result(this->max_node_degree);
+	result.copy_configuration(*this);
+	result.build_merged(*this, rhs, [](bool in_lhs, bool in_rhs) {return in_lhs && !in_rhs;});
+	return result;
+}
+
+//Elements of this are added to target, which is rebuilt with its own degree
+template <class T>
+void BTree<T>::merge_into(BTree& target) const
+{
+	if (&target == this)
+		return;
+
+	target.flush_write_buffer();
+	BTree merged(target.max_node_degree);
+	merged.copy_configuration(target);
+	merged.build_merged(target, *this, [](bool, bool) {return true;});
+
+	target.clear();
+	std::swap(target.root, merged.root);
+	target.structure_version++;
+}
+
+//Rebuilds the tree with fill elements in every node (maximum if 0). Old tree is consumed
+//from the left in chunks of buffer_length elements while the new one is built, so the
+//two together take about as much memory as the tree, plus the buffer.
+template <class T>
+void BTree<T>::compact(int fill, int buffer_length)
+{
+	if (fill == 0)
+		fill = this->max_node_data_length;
+	if (fill < 1 || fill < this->min_node_data_length || fill > this->max_node_data_length)
+		throw("Compaction fill must be between minimum and maximum node length!");
+	if (buffer_length < 1)
+		throw("Compaction buffer length must be positive!");
+
+	this->settle();
+
+	bulk_builder builder;
+	builder.fill = fill;
+	std::vector<T> buffer;
+	buffer.reserve(buffer_length);
+
+	while (this->root != nullptr)
+	{
+		buffer.clear();
+		const_iterator tracker = this->begin();
+		for (; tracker != this->end() && (int)buffer.size() < buffer_length; ++tracker)
+			buffer.push_back(*tracker);
+
+		if (tracker == this->end())
+			this->clear();
+		else
+		{
+			T high = *tracker;
+			this->erase_range(buffer.front(), high);
+		}
+
+		for (int i=0; i < (int)buffer.size(); i++)
+			this->build_push(builder, buffer[i]);
+	}
+
+	if (!builder.open.empty())
+		this->root = this->build_finish(builder);
+	this->structure_version++;
+}
+
+template <class T>
+void BTree<T>::shrink_to_fit()
+{
+	this->compact(this->max_node_data_length);
+}
+
+//Pending messages and tombstones are applied before the nodes are rearranged as a whole
+template <class T>
+void BTree<T>::settle()
+{
+	this->flush_write_buffer();
+	this->purge_tombstones();
+}
+
+template <class T>
+bool BTree<T>::is_tombstone(const T& data) const
+{
+	return !this->tombstones.empty() && this->tombstones.count(data) > 0;
+}
+
+//Whether the subtree has an element that isn't hidden, stops at the first one found
+template <class T>
+bool BTree<T>::has_live_data(Node *node) const
+{
+	typename LinkedList<T>::Node* tracker_data = node->node_data.is_empty() ? nullptr : node->node_data.get_index(0);
+	while (tracker_data != nullptr)
+	{
+		if (!this->is_hidden(tracker_data->get_data()))
+			return true;
+		tracker_data = tracker_data->get_next();
+	}
+
+	typename LinkedList<Node*>::Node* tracker_children = node->is_leaf() ? nullptr : node->children.get_index(0);
+	while (tracker_children != nullptr)
+	{
+		if (this->has_live_data(tracker_children->get_data()))
+			return true;
+		tracker_children = tracker_children->get_next();
+	}
+	return false;
+}
+
+//Inserting a removed but not yet purged element only takes it back from the tombstones
+template <class T>
+bool BTree<T>::revive(const T& data)
+{
+	return !this->tombstones.empty() && this->tombstones.erase(data) > 0;
+}
+
+template <class T>
+void BTree<T>::set_lazy_removal(bool enabled, int max_tombstones)
+{
+	if (max_tombstones < 1)
+		throw("Tombstone limit must be positive!");
+
+	this->lazy_removal = enabled;
+	this->max_tombstones = max_tombstones;
+
+	if (!enabled)
+		this->purge_tombstones();
+	else if ((int)this->tombstones.size() >= max_tombstones)
+		this->purge_tombstones(this->tombstones.size() - max_tombstones + 1);
+}
+
+//Removes at most max_count (all if negative) of the tombstones from the tree, smallest first
+template <class T>
+int BTree<T>::purge_tombstones(int max_count)
+{
+	int purged = 0;
+	while (!this->tombstones.empty() && (max_count < 0 || purged < max_count))
+	{
+		T data = *this->tombstones.begin();
+		this->tombstones.erase(this->tombstones.begin());
+		this->remove_from_tree(data);
+		purged++;
+	}
+	return purged;
+}
+
+template <class T>
+int BTree<T>::tombstone_count() const
+{
+	return this->tombstones.size();
+}
+
+template <class T>
+void BTree<T>::buffer_message(const T& data, bool removal)
+{
+	this->write_buffer[data] = removal;
+	if ((int)this->write_buffer.size() >= this->write_buffer_capacity)
+		this->flush_write_buffer();
+}
+
+template <class T>
+bool BTree<T>::find_buffered(const T& data, bool& removal) const
+{
+	if (this->write_buffer.empty())
+		return false;
+
+	typename std::map<T, bool>::const_iterator message = this->write_buffer.find(data);
+	if (message == this->write_buffer.end())
+		return false;
+	removal = message->second;
+	return true;
+}
+
+//Elements of the nodes that iterators skip: tombstones and the ones having a buffered message.
+//A buffered insert of an element that's already in the nodes is handed out from the buffer.
+template <class T>
+bool BTree<T>::is_hidden(const T& data) const
+{
+	return this->is_tombstone(data) || (!this->write_buffer.empty() && this->write_buffer.count(data) > 0);
+}
+
+template <class T>
+void BTree<T>::set_write_buffer(int capacity)
+{
+	if (capacity < 0)
+		throw("Write buffer capacity cannot be negative!");
+
+	this->write_buffer_capacity = capacity;
+	if ((int)this->write_buffer.size() >= capacity)
+		this->flush_write_buffer();
+}
+
+template <class T>
+void BTree<T>::flush_write_buffer()
+{
+	if (this->write_buffer.empty())
+		return;
+
+	std::map<T, bool> messages;
+	messages.swap(this->write_buffer);
+
+	ArrayStack<Node*> path;
+	for (typename std::map<T, bool>::iterator message = messages.begin(); message != messages.end(); ++message)
+	{
+		if (message->second)
+		{
+			this->apply_removal(message->first);
+			continue;
+		}
+		if (this->root == nullptr || this->revive(message->first))
+		{
+			this->insert_into_tree(message->first);
+			continue;
+		}
+
+		path.clear();
+		path.push(nullptr);
+		const T* upper_bound = nullptr;
+		Node *leaf = this->find_leaf(message->first, path, upper_bound);
+		if (leaf == nullptr)
+			continue;
+		leaf->insert_to_node(message->first, this->max_node_data_length);
+		this->add_to_filter(leaf, message->first);
+
+		//Following inserts below the separator of the leaf go to the same leaf without a new descent
+		typename std::map<T, bool>::iterator next = std::next(message);
+		while (leaf->situation != Node::node_situation::overloaded && next != messages.end())
+		{
+			if (next->second || (upper_bound != nullptr && !(next->first < *upper_bound)) || this->is_tombstone(next->first))
+				break;
+
+			leaf->insert_to_node(next->first, this->max_node_data_length);
+			this->add_to_filter(leaf, next->first);
+			message = next++;
+		}
+		this->split_upwards(path);
+	}
+}
+
+//Leaf that data would be inserted to (nullptr if data exists) and the smallest separator above data
+template <class T>
+typename BTree<T>::Node* BTree<T>::find_leaf(const T& data, ArrayStack<Node*>& path, const T*& upper_bound) const
+{
+	Node *tracker = this->root;
+	typename LinkedList<T>::Node* tracker_data = nullptr;
+	typename LinkedList<Node*>::Node* tracker_children = nullptr;
+
+	while (true)
+	{
+		path.push(tracker);
+		tracker_data = tracker->node_data.get_index(0);
+		tracker_children = tracker->is_leaf() ? nullptr : tracker->children.get_index(0);
+
+		while (tracker_data != nullptr && tracker_data->get_data() < data)
+		{
+			tracker_data = tracker_data->get_next();
+			if (tracker_children != nullptr)
+				tracker_children = tracker_children->get_next();
 		}
-		else
+
+		if (tracker_data != nullptr)
 		{
-			for (int i=0; i < tracker->node_data.length(); i++)
+			if (tracker_data->get_data() == data)
+				return nullptr;
+			upper_bound = &tracker_data->get_data();
+		}
+
+		if (tracker->is_leaf())
+			return tracker;
+		tracker = tracker_children->get_data();
+	}
+}
+
+template <class T>
+void BTree<T>::clear()
+{
+	this->write_buffer.clear();
+	if (this->root == nullptr)
+		return;
+
+	ArrayQueue<Node*> remover;
+	Node* temp = nullptr;
+	typename LinkedList<Node*>::Node* children_tracker = nullptr;
+	remover.enqueue(this->root);
+
+	while (!remover.is_empty())
+	{
+		temp = remover.dequeue();
+		if (!temp->is_leaf())
+		{
+			children_tracker = temp->children.get_index(0);
+			for (int i=0; i < temp->children.length(); i++)
 			{
-				if (data > tracker_node_data->get_data())
-					return nullptr;
-				else if (data == tracker_node_data->get_data())
-					return tracker;
+				remover.enqueue(children_tracker->get_data());
+				children_tracker = children_tracker->get_next();
+			}
+		}
+		this->release_node(temp);
+	}
+	this->root = nullptr;
+	this->tombstones.clear();
+	this->write_buffer.clear();
+	this->structure_version++;
+}
+
+//Mixed std::hash of data, 0 when the type has no std::hash (filters can't be enabled then)
+template <class T>
+unsigned long long BTree<T>::filter_hash(const T& data)
+{
+	if constexpr (std::is_default_constructible<std::hash<T> >::value)
+	{
+		//std::hash of integers is usually identity, so the bits are mixed before they are used
+		return (unsigned long long)std::hash<T>()(data) * 0x9E3779B97F4A7C15ULL;
+	}
+	else
+		return 0;
+}
+
+template <class T>
+unsigned long long BTree<T>::filter_mask(unsigned long long hash)
+{
+	return (1ULL << (hash >> 58)) | (1ULL << ((hash >> 52) & 63)) | (1ULL << ((hash >> 46) & 63));
+}
+
+template <class T>
+bool BTree<T>::filter_rules_out(const Node *node, unsigned long long hash)
+{
+	if (node->filter.empty())
+		return false;
+
+	unsigned long long mask = filter_mask(hash);
+	return (node->filter[(hash >> 20) % node->filter.size()] & mask) != mask;
+}
+
+template <class T>
+int BTree<T>::filter_words() const
+{
+	return (8*this->max_node_data_length + 63) / 64;
+}
+
+template <class T>
+void BTree<T>::add_to_filter(Node *node, const T& data) const
+{
+	if (!node->filter.empty() && node->is_leaf())
+	{
+		unsigned long long hash = filter_hash(data);
+		node->filter[(hash >> 20) % node->filter.size()] |= filter_mask(hash);
+	}
+}
+
+//Elements of merged are moved to node, a filter that says nothing makes the result say nothing too
+template <class T>
+void BTree<T>::merge_filter(Node *node, const Node *merged) const
+{
+	if (node->filter.size() != merged->filter.size())
+	{
+		node->filter.clear();
+		return;
+	}
+
+	for (int i=0; i < (int)node->filter.size(); i++)
+		node->filter[i] |= merged->filter[i];
+}
+
+template <class T>
+void BTree<T>::rebuild_filter(Node *node) const
+{
+	if (!this->leaf_filters || !node->is_leaf())
+		return;
+
+	node->filter.assign(this->filter_words(), 0);
+	typename LinkedList<T>::Node* tracker = node->node_data.is_empty() ? nullptr : node->node_data.get_index(0);
+	while (tracker != nullptr)
+	{
+		this->add_to_filter(node, tracker->get_data());
+		tracker = tracker->get_next();
+	}
+}
+
+//Filters are rebuilt for every leaf when they are enabled, so their state before doesn't matter
+template <class T>
+void BTree<T>::set_leaf_filters(bool enabled)
+{
+	if (!std::is_default_constructible<std::hash<T> >::value && enabled)
+		throw("Leaf filters need std::hash of the element type!");
+
+	this->leaf_filters = enabled;
+	if (!enabled || this->root == nullptr)
+		return;
+
+	ArrayStack<Node*> nodes;
+	nodes.push(this->root);
+	while (!nodes.is_empty())
+	{
+		Node *node = nodes.pop();
+		if (node->is_leaf())
+		{
+			this->rebuild_filter(node);
+			continue;
+		}
+
+		typename LinkedList<Node*>::Node* tracker = node->children.get_index(0);
+		while (tracker != nullptr)
+		{
+			nodes.push(tracker->get_data());
+			tracker = tracker->get_next();
+		}
+	}
+}
+
+template <class T>
+bool BTree<T>::has_leaf_filters() const {return this->leaf_filters;}
+
+template <class T>
+typename BTree<T>::memory_report BTree<T>::memory_usage() const
+{
+	memory_report report = {};
+	int child_count = 0;
+
+	if (this->root != nullptr)
+	{
+		ArrayStack<Node*> nodes;
+		nodes.push(this->root);
+		while (!nodes.is_empty())
+		{
+			Node *node = nodes.pop();
+			report.node_count++;
+			report.node_bytes += (long long)node->filter.capacity()*sizeof(unsigned long long);
+			report.element_count += node->node_data.length();
+			child_count += node->children.length();
+
+			typename LinkedList<Node*>::Node* tracker = node->is_leaf() ? nullptr : node->children.get_index(0);
+			while (tracker != nullptr)
+			{
+				nodes.push(tracker->get_data());
+				tracker = tracker->get_next();
+			}
+		}
+	}
+
+	report.node_bytes += (long long)report.node_count*sizeof(Node);
+	report.key_bytes = (long long)report.element_count*sizeof(T);
+	report.link_bytes = (long long)report.element_count*(sizeof(typename LinkedList<T>::Node) - sizeof(T));
+	report.child_pointer_bytes = (long long)child_count*sizeof(typename LinkedList<Node*>::Node);
+	report.buffer_bytes = (long long)this->write_buffer.size()*(sizeof(std::pair<const T, bool>) + 4*sizeof(void*)) + (long long)this->tombstones.size()*(sizeof(T) + 4*sizeof(void*));
+
+	//A full tree needs about one node per max_node_data_length elements
+	int full_node_count = (report.element_count + this->max_node_data_length-1)/this->max_node_data_length;
+	if (report.node_count > full_node_count)
+		report.slack_bytes = (long long)(report.node_count - full_node_count)*(sizeof(Node) + sizeof(typename LinkedList<Node*>::Node));
+
+	report.total_bytes = report.node_bytes + report.key_bytes + report.link_bytes + report.child_pointer_bytes + report.buffer_bytes;
+	if (report.node_count > 0)
+		report.fill_factor = (double)report.element_count/((long long)report.node_count*this->max_node_data_length);
+	return report;
+}
+
+//Reclaimer must outlive the tree, nullptr goes back to deleting nodes immediately
+template <class T>
+void BTree<T>::set_reclaimer(EpochReclaimer *reclaimer)
+{
+	this->reclaimer = reclaimer;
+}
+
+template <class T>
+void BTree<T>::release_node(Node *node) const
+{
+	if (this->reclaimer != nullptr)
+		this->reclaimer->retire(node);
+	else
+		delete node;
+}
+
+template <class T>
+template <class C>
+void BTree<T>::release_cell(C *cell) const
+{
+	if (this->reclaimer != nullptr)
+		this->reclaimer->retire(cell);
+	else
+		delete cell;
+}
+
+template <class T>
+template <class D>
+void BTree<T>::remove_cell(LinkedList<D>& list, int index) const
+{
+	this->release_cell(list.extract_node_at(index));
+}
+
+#ifdef BTREE_INSTRUMENTATION
+template <class T>
+BTreeInstrumentation& BTree<T>::get_instrumentation() const
+{
+	return this->instrumentation;
+}
+#endif
+
+//Read only descent: data and children lists of a node are walked together, one pass per level
+template <class T>
+typename BTree<T>::Node* BTree<T>::find_node(const T& data) const
+{
+	Node *tracker = this->root;
+	typename LinkedList<T>::Node* tracker_data = nullptr;
+	typename LinkedList<Node*>::Node* tracker_children = nullptr;
+	unsigned long long hash = this->leaf_filters ? filter_hash(data) : 0;
+
+	while (tracker != nullptr)
+	{
+		//Leaf filter rules out most absent data without walking the leaf
+		if (this->leaf_filters && tracker->is_leaf() && filter_rules_out(tracker, hash))
+			return nullptr;
+
+		tracker_data = tracker->node_data.is_empty() ? nullptr : tracker->node_data.get_index(0);
+		tracker_children = tracker->is_leaf() ? nullptr : tracker->children.get_index(0);
+
+		while (tracker_data != nullptr && tracker_data->get_data() < data)
+		{
+			tracker_data = tracker_data->get_next();
+			if (tracker_children != nullptr)
+				tracker_children = tracker_children->get_next();
+		}
+
+		if (tracker_data != nullptr && tracker_data->get_data() == data)
+			return tracker;
+		else if (tracker_children == nullptr)
+			return nullptr;
+		tracker = tracker_children->get_data();
+	}
+	return nullptr;
+}
+
+template <class T>
+typename BTree<T>::Node* BTree<T>::search(T data) const
+{
+	BTREE_OPERATION(search);
+	bool removal;
+	if (this->find_buffered(data, removal))
+	{
+		if (!removal)
+			throw("Element is only in the write buffer, it has no node before a flush!");
+		return nullptr;
+	}
+	if (this->is_tombstone(data))
+		return nullptr;
+	return this->find_node(data);
+}
+
+template <class T>
+bool BTree<T>::contains(const T& data) const
+{
+	BTREE_OPERATION(search);
+	bool removal;
+	if (this->find_buffered(data, removal))
+		return !removal;
+	return !this->is_tombstone(data) && this->find_node(data) != nullptr;
+}
+
+#ifdef BTREE_COROUTINES
+//Same descent as find_node, but every node is fetched from the provider first and the lookup
+//suspends until it's ready. Tree must not change until the lookup is done.
+template <class T>
+template <class P>
+LookupTask BTree<T>::co_search(T data, P& provider) const
+{
+	bool removal;
+	if (this->find_buffered(data, removal))
+		co_return !removal;
+	if (this->is_tombstone(data))
+		co_return false;
+
+	Node *tracker = this->root;
+	unsigned long long hash = this->leaf_filters ? filter_hash(data) : 0;
+
+	while (tracker != nullptr)
+	{
+		co_await provider.fetch(tracker);
+		if (this->leaf_filters && tracker->is_leaf() && filter_rules_out(tracker, hash))
+			co_return false;
+
+		typename LinkedList<T>::Node* tracker_data = tracker->node_data.is_empty() ? nullptr : tracker->node_data.get_index(0);
+		typename LinkedList<Node*>::Node* tracker_children = tracker->is_leaf() ? nullptr : tracker->children.get_index(0);
+
+		while (tracker_data != nullptr && tracker_data->get_data() < data)
+		{
+			tracker_data = tracker_data->get_next();
+			if (tracker_children != nullptr)
+				tracker_children = tracker_children->get_next();
+		}
+
+		if (tracker_data != nullptr && tracker_data->get_data() == data)
+			co_return true;
+		else if (tracker_children == nullptr)
+			co_return false;
+		tracker = tracker_children->get_data();
+	}
+	co_return false;
+}
+#endif
+
+template <class T>
+typename BTree<T>::const_iterator BTree<T>::find(const T& data) const
+{
+	BTREE_OPERATION(search);
+	return this->find_from(const_iterator(), data);
+}
+
+template <class T>
+typename BTree<T>::const_iterator BTree<T>::find_from(const_iterator hint, T data) const
+{
+	BTREE_OPERATION(search);
+	bool removal;
+	if (this->find_buffered(data, removal))
+		return removal ? this->end() : this->lower_bound(data);
+
+	const_iterator position(this);
+	if (this->root == nullptr || this->is_tombstone(data) || !this->locate_from(hint, data, position))
+		return this->end();
+	position.message = this->write_buffer.lower_bound(data);
+	position.settle();
+	return position;
+}
+
+//Iterator to the smallest element not less than data
+template <class T>
+typename BTree<T>::const_iterator BTree<T>::lower_bound(const T& data) const
+{
+	BTREE_OPERATION(search);
+	const_iterator position(this);
+	position.message = this->write_buffer.lower_bound(data);
+
+	if (this->root != nullptr)
+	{
+		position.nodes.push_back(this->root);
+		if (!this->descend_from(data, position) && position.current == nullptr)
+		{
+			//Every element of the leaf is less than data, next one is on the first ancestor having data on the right
+			do
+			{
+				position.nodes.pop_back();
+				position.indices.pop_back();
+			} while (!position.nodes.empty() && position.indices.back() >= position.nodes.back()->node_data.length());
+
+			if (!position.nodes.empty())
+				position.current = position.nodes.back()->node_data.get_index(position.indices.back());
+		}
+	}
+	position.settle();
+	return position;
+}
+
+template <class T>
+typename BTree<T>::const_iterator BTree<T>::begin() const
+{
+	const_iterator position(this);
+	position.message = this->write_buffer.begin();
+
+	if (this->root != nullptr)
+	{
+		Node *tracker = this->root;
+		position.nodes.push_back(tracker);
+
+		while (!tracker->is_leaf())
+		{
+			position.indices.push_back(0);
+			tracker = tracker->children.get_index(0)->get_data();
+			position.nodes.push_back(tracker);
+		}
+		position.indices.push_back(0);
+		position.current = tracker->node_data.get_index(0);
+	}
+	position.settle();
+	return position;
+}
+
+template <class T>
+typename BTree<T>::const_iterator BTree<T>::end() const
+{
+	return const_iterator(this);
+}
+
+template <class T>
+bool BTree<T>::is_valid_hint(const const_iterator& hint) const
+{
+	return hint.tree == this && hint.version == this->structure_version && !hint.nodes.empty();
+}
+
+template <class T>
+bool BTree<T>::in_node_range(Node* node, const T& data) const
+{
+	if (node->node_data.length() == 0)
+		return false;
+
+	const T& first = node->node_data.get_index(0)->get_data();
+	const T& last = node->node_data.get_tail()->get_data();
+	return !(data < first) && !(last < data);
+}
+
+template <class T>
+bool BTree<T>::descend_from(const T& data, const_iterator& position) const
+{
+	Node *tracker = position.nodes.back();
+	typename LinkedList<T>::Node* tracker_data = nullptr;
+	typename LinkedList<Node*>::Node* tracker_children = nullptr;
+
+	while (true)
+	{
+		int index = 0;
+		tracker_data = tracker->node_data.is_empty() ? nullptr : tracker->node_data.get_index(0);
+		tracker_children = tracker->is_leaf() ? nullptr : tracker->children.get_index(0);
+
+		while (tracker_data != nullptr && tracker_data->get_data() < data)
+		{
+			tracker_data = tracker_data->get_next();
+			if (tracker_children != nullptr)
+				tracker_children = tracker_children->get_next();
+			index++;
+		}
+
+		position.indices.push_back(index);
+		position.current = tracker_data;
+
+		if (tracker_data != nullptr && tracker_data->get_data() == data)
+			return true;
+		else if (tracker->is_leaf())
+			return false;
+
+		tracker = tracker_children->get_data();
+		position.nodes.push_back(tracker);
+	}
+}
+
+//Starts from the deepest node of the hint whose range covers data, the root otherwise
+template <class T>
+bool BTree<T>::locate_from(const const_iterator& hint, const T& data, const_iterator& position) const
+{
+	if (this->is_valid_hint(hint))
+	{
+		position.nodes = hint.nodes;
+		position.indices = hint.indices;
+		position.indices.pop_back();
 
-				tracker_node_data = tracker_node_data->get_next();
-			}
-			return nullptr;
+		while (position.nodes.size() > 1 && !this->in_node_range(position.nodes.back(), data))
+		{
+			position.nodes.pop_back();
+			position.indices.pop_back();
 		}
 	}
-	return nullptr;
+	else
+		position.nodes.push_back(this->root);
+
+	return this->descend_from(data, position);
+}
+
+template <class T>
+void BTree<T>::refresh_rightmost_path()
+{
+	this->rightmost_path.clear();
+
+	Node *tracker = this->root;
+	this->rightmost_path.push_back(tracker);
+	while (!tracker->is_leaf())
+	{
+		tracker = tracker->children.get_tail()->get_data();
+		this->rightmost_path.push_back(tracker);
+	}
+	this->rightmost_version = this->structure_version;
 }
 
+//Formatting goes to a local buffer which is written to the stream in big chunks
 template <class T>
-void BTree<T>::inorder_display() const
+void BTree<T>::flush_display(std::ostringstream& buffer, std::ostream& out, bool force)
 {
-	inorder_display(this->root);
-	std::cout << std::endl;
+	if (force || buffer.tellp() >= 1 << 16)
+	{
+		const std::string& text = buffer.str();
+		out.write(text.data(), text.size());
+		buffer.str("");
+	}
+}
+
+template <class T>
+void BTree<T>::inorder_display(std::ostream& out) const
+{
+	std::ostringstream buffer;
+
+	if (this->is_empty())
+		buffer << '\n';
+
+	this->for_each_inorder([&](const T& data)
+	{
+		buffer << data << ' ';
+		flush_display(buffer, out, false);
+	});
+	buffer << '\n';
+	flush_display(buffer, out, true);
 }
 
 template <class T>
-void BTree<T>::levelorder_display() const
+void BTree<T>::levelorder_display(std::ostream& out) const
 {
 	if (this->root == nullptr)
 	{
 		//std::cout << "Empty" << std::endl;
-		std::cout << std::endl;
+		out << '\n';
 		return;
 	}
 
-	Queue<Node*> level;
-	Queue<Node*> parent;
+	ArrayQueue<Node*> level;
+	ArrayQueue<Node*> parent;
 	Node* temp = nullptr, *temp2 = nullptr;
+	std::ostringstream buffer;
 
 	typename LinkedList<T>::Node* data_tracker = nullptr;
 	typename LinkedList<Node*>::Node* children_tracker = nullptr;
@@ -1024,7 +2449,7 @@ void BTree<T>::levelorder_display() const
 	parent.enqueue(nullptr);
 
 	int level_length;
-	std::cout << std::endl << "Root: ";
+	buffer << '\n' << "Root: ";
 
 	while (!level.is_empty())
 	{
@@ -1036,17 +2461,17 @@ void BTree<T>::levelorder_display() const
 			temp2 = parent.dequeue();
 
 			if (temp2 != nullptr)
-				std::cout << temp2->node_data.get_index(0)->get_data() << ": ";
+				buffer << temp2->node_data.get_index(0)->get_data() << ": ";
 
 			data_tracker = temp->node_data.get_index(0);
-			std::cout << "(";
+			buffer << "(";
 
 			for (int i=0; i < temp->node_data.length()-1; i++)
 			{
-				std::cout << data_tracker->get_data() << ",";
+				buffer << data_tracker->get_data() << ",";
 				data_tracker = data_tracker->get_next();
 			}
-			std::cout << data_tracker->get_data() << ")    ";
+			buffer << data_tracker->get_data() << ")    ";
 
 			if (!temp->is_leaf())
 			{
@@ -1062,68 +2487,420 @@ void BTree<T>::levelorder_display() const
 						parent.enqueue(nullptr);
 				}
 			}
+			flush_display(buffer, out, false);
 		}
-		std::cout << std::endl;
+		buffer << '\n';
 	}
-	std::cout << std::endl;
+	buffer << '\n';
+	flush_display(buffer, out, true);
 	return;
 }
 
 template <class T>
-void BTree<T>::inorder_display(Node* node) const
+template <class F>
+void BTree<T>::for_each_inorder(F function) const
 {
-	if (node == nullptr)
+	if (this->write_buffer.empty())
 	{
-		std::cout << std::endl;
-		return;
+		if (this->root == nullptr)
+			return;
+		if (this->tombstones.empty())
+			return this->for_each_inorder(this->root, function);
+
+		auto alive = [&](const T& data)
+		{
+			if (!this->is_tombstone(data))
+				function(data);
+		};
+		return this->for_each_inorder(this->root, alive);
 	}
 
-	typename LinkedList<T>::Node* tracker_data = node->node_data.get_index(0);
-	typename LinkedList<Node*>::Node* tracker_children = nullptr;
+	//Buffered messages are merged into the inorder walk, their latest state wins
+	typename std::map<T, bool>::const_iterator message = this->write_buffer.begin();
+	auto merged = [&](const T& data)
+	{
+		for (; message != this->write_buffer.end() && message->first < data; ++message)
+			if (!message->second)
+				function(message->first);
+
+		if (message != this->write_buffer.end() && message->first == data)
+		{
+			if (!message->second)
+				function(data);
+			++message;
+		}
+		else if (!this->is_tombstone(data))
+			function(data);
+	};
+	if (this->root != nullptr)
+		this->for_each_inorder(this->root, merged);
+
+	for (; message != this->write_buffer.end(); ++message)
+		if (!message->second)
+			function(message->first);
+}
+
+template <class T>
+template <class F>
+void BTree<T>::for_each_inorder(Node* node, F& function) const
+{
+	typename LinkedList<T>::Node* tracker_data = node->node_data.is_empty() ? nullptr : node->node_data.get_index(0);
 
 	if (node->is_leaf())
 	{
-		for (int i=0; i < node->node_data.length(); i++)
+		while (tracker_data != nullptr)
 		{
-			std::cout << tracker_data->get_data() << " ";
+			function(tracker_data->get_data());
 			tracker_data = tracker_data->get_next();
 		}
+		return;
+	}
+
+	typename LinkedList<Node*>::Node* tracker_children = node->children.get_index(0);
+	while (tracker_data != nullptr)
+	{
+		this->for_each_inorder(tracker_children->get_data(), function);
+		function(tracker_data->get_data());
+		tracker_data = tracker_data->get_next();
+		tracker_children = tracker_children->get_next();
+	}
+	this->for_each_inorder(tracker_children->get_data(), function);
+}
+
+template <class T>
+int BTree<T>::default_thread_count(int thread_count)
+{
+	if (thread_count > 0)
+		return thread_count;
+	thread_count = std::thread::hardware_concurrency();
+	return thread_count > 0 ? thread_count : 1;
+}
+
+//Splits the tree at the first level having enough nodes to keep every thread busy.
+//Buffered messages aren't in the subtrees, then the whole merged walk is a single task.
+template <class T>
+void BTree<T>::create_tasks(int thread_count, std::vector<traversal_task>& tasks) const
+{
+	if (!this->write_buffer.empty())
+	{
+		tasks.push_back({nullptr, nullptr});
+		return;
+	}
+	if (this->root == nullptr)
+		return;
+
+	std::vector<Node*> level(1, this->root), next_level;
+	int split_depth = 0;
+
+	while ((int)level.size() < 4*thread_count && !level.front()->is_leaf())
+	{
+		next_level.clear();
+		for (int i=0; i < (int)level.size(); i++)
+		{
+			typename LinkedList<Node*>::Node* tracker = level[i]->children.get_index(0);
+			while (tracker != nullptr)
+			{
+				next_level.push_back(tracker->get_data());
+				tracker = tracker->get_next();
+			}
+		}
+		level.swap(next_level);
+		split_depth++;
+	}
+	this->create_tasks(this->root, 0, split_depth, tasks);
+}
+
+template <class T>
+void BTree<T>::create_tasks(Node *node, int depth, int split_depth, std::vector<traversal_task>& tasks) const
+{
+	if (depth == split_depth || node->is_leaf())
+	{
+		tasks.push_back({node, nullptr});
+		return;
+	}
+
+	typename LinkedList<T>::Node* tracker_data = node->node_data.get_index(0);
+	typename LinkedList<Node*>::Node* tracker_children = node->children.get_index(0);
+	while (tracker_data != nullptr)
+	{
+		this->create_tasks(tracker_children->get_data(), depth+1, split_depth, tasks);
+		tasks.push_back({nullptr, &tracker_data->get_data()});
+		tracker_data = tracker_data->get_next();
+		tracker_children = tracker_children->get_next();
+	}
+	this->create_tasks(tracker_children->get_data(), depth+1, split_depth, tasks);
+}
+
+//Elements of the task are copied inorder into a contiguous block, function(block, length) runs per block
+template <class T>
+template <class F>
+void BTree<T>::for_each_block(const traversal_task& task, F& function) const
+{
+	if (task.subtree == nullptr && task.data != nullptr)
+	{
+		if (!this->is_tombstone(*task.data))
+			function(task.data, 1);
+		return;
 	}
+
+	const int block_size = 256;
+	std::vector<T> block;
+	block.reserve(block_size);
+
+	auto collect = [&](const T& data)
+	{
+		block.push_back(data);
+		if (block.size() == block_size)
+		{
+			function(block.data(), block.size());
+			block.clear();
+		}
+	};
+	auto alive = [&](const T& data)
+	{
+		if (!this->is_tombstone(data))
+			collect(data);
+	};
+
+	//The merged walk skips the tombstones itself
+	if (task.subtree == nullptr)
+		this->for_each_inorder(collect);
 	else
+		this->for_each_inorder(task.subtree, alive);
+	if (!block.empty())
+		function(block.data(), block.size());
+}
+
+//The threads are started for this call and joined before it returns, so every call pays
+//thread_count-1 thread starts. Small trees or calls in a loop are faster with thread_count 1.
+template <class T>
+template <class F>
+void BTree<T>::run_tasks(int task_count, int thread_count, F function)
+{
+	if (thread_count > task_count)
+		thread_count = task_count;
+
+	std::atomic<int> next_task(0);
+	auto worker = [&]()
+	{
+		for (int i = next_task++; i < task_count; i = next_task++)
+			function(i);
+	};
+
+	std::vector<std::thread> threads;
+	for (int i=1; i < thread_count; i++)
+		threads.emplace_back(worker);
+	worker();
+
+	for (int i=0; i < (int)threads.size(); i++)
+		threads[i].join();
+}
+
+//function is called concurrently from several threads, in no particular order
+template <class T>
+template <class F>
+void BTree<T>::parallel_for_each(F function, int thread_count) const
+{
+	thread_count = default_thread_count(thread_count);
+	std::vector<traversal_task> tasks;
+	this->create_tasks(thread_count, tasks);
+
+	run_tasks(tasks.size(), thread_count, [&](int i)
 	{
-		tracker_children = node->children.get_index(0);
-		for (int i=0; i < node->node_data.length(); i++)
+		auto block_function = [&](const T* block, int length)
 		{
-			inorder_display(tracker_children->get_data());
-			std::cout << tracker_data->get_data() << " ";
-			tracker_data = tracker_data->get_next();
-			tracker_children = tracker_children->get_next();
+			for (int j=0; j < length; j++)
+				function(block[j]);
+		};
+		this->for_each_block(tasks[i], block_function);
+	});
+}
+
+//op must be associative and take (R, R), elements are converted to R
+template <class T>
+template <class R, class Op>
+R BTree<T>::reduce(R identity, Op op, int thread_count) const
+{
+	thread_count = default_thread_count(thread_count);
+	std::vector<traversal_task> tasks;
+	this->create_tasks(thread_count, tasks);
+	std::vector<R> partial(tasks.size(), identity);
+
+	run_tasks(tasks.size(), thread_count, [&](int i)
+	{
+		R result = identity;
+		auto block_function = [&](const T* block, int length)
+		{
+			for (int j=0; j < length; j++)
+				result = op(result, R(block[j]));
+		};
+		this->for_each_block(tasks[i], block_function);
+		partial[i] = result;
+	});
+
+	R result = identity;
+	for (int i=0; i < (int)partial.size(); i++)
+		result = op(result, partial[i]);
+	return result;
+}
+
+template <class T>
+template <class P>
+int BTree<T>::count_if(P predicate, int thread_count) const
+{
+	thread_count = default_thread_count(thread_count);
+	std::vector<traversal_task> tasks;
+	this->create_tasks(thread_count, tasks);
+	std::vector<int> partial(tasks.size(), 0);
+
+	run_tasks(tasks.size(), thread_count, [&](int i)
+	{
+		int count = 0;
+		auto block_function = [&](const T* block, int length)
+		{
+			//Branch free so that the loop can be vectorized
+			for (int j=0; j < length; j++)
+				count += predicate(block[j]) ? 1 : 0;
+		};
+		this->for_each_block(tasks[i], block_function);
+		partial[i] = count;
+	});
+
+	int count = 0;
+	for (int i=0; i < (int)partial.size(); i++)
+		count += partial[i];
+	return count;
+}
+
+//Matching elements are returned in ascending order
+template <class T>
+template <class P>
+std::vector<T> BTree<T>::filter_to_vector(P predicate, int thread_count) const
+{
+	thread_count = default_thread_count(thread_count);
+	std::vector<traversal_task> tasks;
+	this->create_tasks(thread_count, tasks);
+	std::vector<std::vector<T> > partial(tasks.size());
+
+	run_tasks(tasks.size(), thread_count, [&](int i)
+	{
+		auto block_function = [&](const T* block, int length)
+		{
+			for (int j=0; j < length; j++)
+				if (predicate(block[j]))
+					partial[i].push_back(block[j]);
+		};
+		this->for_each_block(tasks[i], block_function);
+	});
+
+	std::vector<T> result;
+	for (int i=0; i < (int)partial.size(); i++)
+		result.insert(result.end(), partial[i].begin(), partial[i].end());
+	return result;
+}
+
+//function(data, level) for every element, root level (0) first
+template <class T>
+template <class F>
+void BTree<T>::for_each_level(F function) const
+{
+	this->visit_nodes([&](const LinkedList<T>& node_data, int level)
+	{
+		typename LinkedList<T>::Node* tracker = node_data.is_empty() ? nullptr : node_data.get_index(0);
+		while (tracker != nullptr)
+		{
+			if (!this->is_tombstone(tracker->get_data()))
+				function(tracker->get_data(), level);
+			tracker = tracker->get_next();
+		}
+	});
+}
+
+//function(node_data, level) for every node in level order
+template <class T>
+template <class F>
+void BTree<T>::visit_nodes(F function) const
+{
+	if (this->root == nullptr)
+		return;
+
+	ArrayQueue<Node*> nodes;
+	ArrayQueue<int> levels;
+	Node* temp = nullptr;
+	int level;
+	typename LinkedList<Node*>::Node* children_tracker = nullptr;
+
+	nodes.enqueue(this->root);
+	levels.enqueue(0);
+
+	while (!nodes.is_empty())
+	{
+		temp = nodes.dequeue();
+		level = levels.dequeue();
+		function(static_cast<const LinkedList<T>&>(temp->node_data), level);
+
+		children_tracker = temp->is_leaf() ? nullptr : temp->children.get_index(0);
+		while (children_tracker != nullptr)
+		{
+			nodes.enqueue(children_tracker->get_data());
+			levels.enqueue(level+1);
+			children_tracker = children_tracker->get_next();
 		}
-		inorder_display(tracker_children->get_data());
 	}
 }
 
 template <class T>
 BTree<T>& BTree<T>::operator=(const BTree& rhs)
 {
-	this->clear();
-	if (rhs.root == nullptr)
+	if (this == &rhs)
 		return *this;
 
-	*this = BTree<T>(rhs.max_node_degree);
+	this->clear();
+	this->max_node_degree = rhs.max_node_degree;
+	this->max_node_data_length = rhs.max_node_data_length;
+	this->min_node_data_length = rhs.min_node_data_length;
+	this->copy_configuration(rhs);
+	this->tombstones = rhs.tombstones;
+	this->write_buffer = rhs.write_buffer;
+
 	if (rhs.root != nullptr)
 	{
 		this->root = new Node;
 		rec_create(this->root, rhs.root);
 	}
 
+	this->structure_version++;
+	return *this;
+}
+
+template <class T>
+BTree<T>& BTree<T>::operator=(BTree&& rhs)
+{
+	if (this == &rhs)
+		return *this;
+
+	this->clear();
+	this->max_node_degree = rhs.max_node_degree;
+	this->max_node_data_length = rhs.max_node_data_length;
+	this->min_node_data_length = rhs.min_node_data_length;
+	this->copy_configuration(rhs);
+
+	//Nodes are taken over, rhs is left empty
+	this->root = rhs.root;
+	rhs.root = nullptr;
+	this->tombstones.swap(rhs.tombstones);
+	this->write_buffer.swap(rhs.write_buffer);
+
+	this->structure_version++;
+	rhs.structure_version++;
 	return *this;
 }
 
 template <class T>
 void BTree<T>::copy_to(BTree& rhs)
 {
-	Queue<T> data_list;
+	this->flush_write_buffer();
+	ArrayQueue<T> data_list;
 	create_data_list(this->root, data_list);
 
 	rhs.clear();
@@ -1136,7 +2913,7 @@ void BTree<T>::copy_to(BTree& rhs)
 }
 
 template <class T>
-void BTree<T>::create_data_list(Node* node, Queue<T>& data_list)
+void BTree<T>::create_data_list(Node* node, ArrayQueue<T>& data_list)
 {
 	if (node == nullptr || node->node_data.length() == 0)
 		return;
@@ -1146,7 +2923,8 @@ void BTree<T>::create_data_list(Node* node, Queue<T>& data_list)
 	int len = node->node_data.length();
 	for (int i=0; i < len; i++)
 	{
-		data_list.enqueue(tracker->get_data());
+		if (!this->is_tombstone(tracker->get_data()))
+			data_list.enqueue(tracker->get_data());
 		tracker = tracker->get_next();
 	}
 
@@ -1163,10 +2941,172 @@ void BTree<T>::create_data_list(Node* node, Queue<T>& data_list)
 	}
 }
 
+template <class T>
+FrozenBTree<T> BTree<T>::freeze() const
+{
+	std::vector<T> data_list;
+	this->for_each_inorder([&](const T& data) {data_list.push_back(data);});
+	return FrozenBTree<T>(data_list);
+}
+
+//Iterator functions start
+template <class T>
+const T& BTree<T>::const_iterator::operator*() const
+{
+	if (this->from_buffer())
+		return this->message->first;
+	if (this->current == nullptr)
+		throw("End iterator cannot be dereferenced!");
+	return this->current->get_data();
+}
+
+template <class T>
+const T* BTree<T>::const_iterator::operator->() const
+{
+	return &**this;
+}
+
+template <class T>
+typename BTree<T>::const_iterator& BTree<T>::const_iterator::operator++()
+{
+	if (this->at_end())
+		throw("End iterator cannot be incremented!");
+
+	if (this->from_buffer())
+		++this->message;
+	else
+		this->step();
+	this->settle();
+	return *this;
+}
+
+//Moves the node position past hidden elements and the buffer position past removals
+template <class T>
+void BTree<T>::const_iterator::settle()
+{
+	while (!this->nodes.empty() && this->tree->is_hidden(this->current->get_data()))
+		this->step();
+	while (this->message != this->tree->write_buffer.end() && this->message->second)
+		++this->message;
+}
+
+template <class T>
+bool BTree<T>::const_iterator::at_end() const
+{
+	return this->nodes.empty() && (this->tree == nullptr || this->message == this->tree->write_buffer.end());
+}
+
+//Whether the element is the next buffered insert rather than the one in the nodes
+template <class T>
+bool BTree<T>::const_iterator::from_buffer() const
+{
+	if (this->tree == nullptr || this->message == this->tree->write_buffer.end())
+		return false;
+	return this->nodes.empty() || this->message->first < this->current->get_data();
+}
+
+template <class T>
+void BTree<T>::const_iterator::step()
+{
+	Node *tracker = this->nodes.back();
+
+	if (tracker->is_leaf())
+	{
+		this->current = this->current->get_next();
+		this->indices.back()++;
+		if (this->current != nullptr)
+			return;
+
+		//Leaf finished, go up until an ancestor still has data on the right
+		do
+		{
+			this->nodes.pop_back();
+			this->indices.pop_back();
+		} while (!this->nodes.empty() && this->indices.back() >= this->nodes.back()->node_data.length());
+
+		if (!this->nodes.empty())
+			this->current = this->nodes.back()->node_data.get_index(this->indices.back());
+		return;
+	}
+
+	//Next data of an inner node is the smallest one of its right subtree
+	this->indices.back()++;
+	tracker = tracker->children.get_index(this->indices.back())->get_data();
+	this->nodes.push_back(tracker);
+
+	while (!tracker->is_leaf())
+	{
+		this->indices.push_back(0);
+		tracker = tracker->children.get_index(0)->get_data();
+		this->nodes.push_back(tracker);
+	}
+	this->indices.push_back(0);
+	this->current = tracker->node_data.get_index(0);
+}
+
+template <class T>
+typename BTree<T>::const_iterator BTree<T>::const_iterator::operator++(int)
+{
+	const_iterator temp = *this;
+	++*this;
+	return temp;
+}
+
+template <class T>
+bool BTree<T>::const_iterator::operator==(const const_iterator& rhs) const
+{
+	if (this->at_end() || rhs.at_end())
+		return this->at_end() && rhs.at_end();
+	if (this->from_buffer() || rhs.from_buffer())
+		return this->from_buffer() && rhs.from_buffer() && this->message == rhs.message;
+	return this->current == rhs.current;
+}
+
+template <class T>
+bool BTree<T>::const_iterator::operator!=(const const_iterator& rhs) const
+{
+	return !(*this == rhs);
+}
+//Iterator functions end
+
+template <class T>
+void BTree<T>::set_split_policy(split_policy policy)
+{
+	this->policy = policy;
+	this->sequential_inserts = 0;
+}
+
+template <class T>
+typename BTree<T>::split_policy BTree<T>::get_split_policy() const
+{
+	return this->policy;
+}
+
 template <class T>
 bool BTree<T>::is_empty() const
 {
-	return this->root == nullptr;
+	for (typename std::map<T, bool>::const_iterator message = this->write_buffer.begin(); message != this->write_buffer.end(); ++message)
+		if (!message->second)
+			return false;
+
+	//Tombstones and buffered removals can hide every element of the nodes
+	if (this->root == nullptr)
+		return true;
+	if (this->tombstones.empty() && this->write_buffer.empty())
+		return false;
+	return !this->has_live_data(this->root);
+}
+
+//Split policy, reclaimer and the lazy removal, write buffer and leaf filter settings, not the elements
+template <class T>
+void BTree<T>::copy_configuration(const BTree& from)
+{
+	this->policy = from.policy;
+	this->reclaimer = from.reclaimer;
+	this->lazy_removal = from.lazy_removal;
+	this->max_tombstones = from.max_tombstones;
+	this->write_buffer_capacity = from.write_buffer_capacity;
+	this->leaf_filters = from.leaf_filters;
 }
 
 template <class T>
@@ -1175,32 +3115,26 @@ void BTree<T>::rec_create(Node* to, Node* from)
 	if (from != nullptr)
 	{
 		to->node_data = from->node_data;
+		to->situation = from->situation;
+		to->filter = from->filter;
 
-		LinkedList<Node*> & from_child_ref = from->children;
-		int len = from_child_ref.length();
-
-		if (len == 0)
+		if (from->is_leaf())
 			return;
 
-		Stack<Node*> nodes_endtobegin;
-		typename LinkedList<Node*>::Node* tracker = from_child_ref.get_index(0);
-
-		for (int i=0; i < len; i++)
-		{
-			nodes_endtobegin.push(tracker->get_data());
-			tracker = tracker->get_next();
-		}
-
-		for (int i=0; i < len; i++)
+		typename LinkedList<Node*>::Node* tracker = from->children.get_index(0);
+		while (tracker != nullptr)
 		{
-			Node* temp = nodes_endtobegin.pop();
 			Node* created = new Node;
-			to->children.insert_at(created, 0);
-			rec_create(created, temp);
+			to->children.push_back(created);
+			rec_create(created, tracker->get_data());
+			tracker = tracker->get_next();
 		}
 	}
 }
 //Tree functions end
 
 
+#undef BTREE_OPERATION
+#undef BTREE_TRACE
+
 #endif
\ No newline at end of file
@@ -0,0 +1,257 @@
+#ifndef BTREE_INSTRUMENTATION_HPP
+#define BTREE_INSTRUMENTATION_HPP
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <ostream>
+#include <vector>
+
+//Log-linear latency histogram in the style of HDR histograms: values below 32 have their
+//own bucket, bigger values are grouped by their highest bit and the 4 bits behind it,
+//so every recorded value is within ~6% of its bucket's upper bound.
+//Counters are atomic, so threads can record into the same histogram.
+class LatencyHistogram
+{
+	static const int linear_buckets = 32;
+	static const int sub_buckets = 16;
+	static const int bucket_count = linear_buckets + (64-5)*sub_buckets;
+
+	std::atomic<long long> counts[bucket_count];
+	std::atomic<long long> total;
+	std::atomic<long long> max_value;
+
+	static int bucket_of(unsigned long long value);
+	static long long bucket_upper_bound(int bucket);
+
+public:
+	LatencyHistogram() {this->clear();}
+
+	void record(long long value);
+	long long percentile(double percent) const;
+	long long count() const;
+	long long max() const;
+	void clear();
+};
+
+inline int LatencyHistogram::bucket_of(unsigned long long value)
+{
+	if (value < linear_buckets)
+		return value;
+
+	int highest_bit;
+#ifdef __GNUC__
+	highest_bit = 63 - __builtin_clzll(value);
+#else
+	highest_bit = 0;
+	while (value >> (highest_bit+1))
+		highest_bit++;
+#endif
+	int top = value >> (highest_bit-4);//16..31
+	return linear_buckets + (highest_bit-5)*sub_buckets + (top-sub_buckets);
+}
+
+inline long long LatencyHistogram::bucket_upper_bound(int bucket)
+{
+	if (bucket < linear_buckets)
+		return bucket;
+
+	int highest_bit = (bucket-linear_buckets)/sub_buckets + 5;
+	unsigned long long top = (bucket-linear_buckets)%sub_buckets + sub_buckets;
+	return (long long)(((top+1) << (highest_bit-4)) - 1);
+}
+
+inline void LatencyHistogram::record(long long value)
+{
+	if (value < 0)
+		value = 0;
+
+	this->counts[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+	this->total.fetch_add(1, std::memory_order_relaxed);
+	long long max_value = this->max_value.load(std::memory_order_relaxed);
+	while (value > max_value && !this->max_value.compare_exchange_weak(max_value, value, std::memory_order_relaxed));
+}
+
+//Smallest bucket bound that is not less than given percent of the values (e.g. 99.9)
+inline long long LatencyHistogram::percentile(double percent) const
+{
+	long long total = this->total.load(std::memory_order_relaxed);
+	long long max_value = this->max_value.load(std::memory_order_relaxed);
+	if (total == 0)
+		return 0;
+
+	long long needed = (long long)(percent/100*total + 0.5);
+	if (needed < 1)
+		needed = 1;
+
+	long long seen = 0;
+	for (int i=0; i < bucket_count; i++)
+	{
+		seen += this->counts[i].load(std::memory_order_relaxed);
+		if (seen >= needed)
+			return bucket_upper_bound(i) < max_value ? bucket_upper_bound(i) : max_value;
+	}
+	return max_value;
+}
+
+inline long long LatencyHistogram::count() const {return this->total;}
+
+inline long long LatencyHistogram::max() const {return this->max_value;}
+
+inline void LatencyHistogram::clear()
+{
+	for (int i=0; i < bucket_count; i++)
+		this->counts[i] = 0;
+	this->total = 0;
+	this->max_value = 0;
+}
+
+//Statistics and trace hooks of a BTree, only compiled in with BTREE_INSTRUMENTATION.
+//Every public insert, remove and search is timed, and the split/merge events it causes
+//are counted as its cascade depth.
+//Operations of a const tree can run on several threads at once: statistics are atomic,
+//and nesting and cascade depth are kept per thread by the scopes of that thread.
+class BTreeInstrumentation
+{
+public:
+	enum class operation{insert, remove, search};
+	enum class trace_event{split, merge};
+
+	static const int max_cascade_depth = 16;
+
+	struct operation_statistics
+	{
+		LatencyHistogram latency;
+		LatencyHistogram latency_with_cascade;//only operations that split or merged
+		std::atomic<long long> cascade_depths[max_cascade_depth+1];//last one counts all deeper cascades
+	};
+
+	//Times the outermost operation while it's alive, nested operations count for it.
+	//Scopes of a thread are chained, so operations of other trees nested in it are timed apart.
+	class scope
+	{
+		BTreeInstrumentation& instrumentation;
+		operation kind;
+		bool outermost;
+		int cascade_depth;
+		std::chrono::steady_clock::time_point start;
+		scope *enclosing;
+
+		static scope*& innermost();
+		static scope* outermost_of(const BTreeInstrumentation& instrumentation);
+
+		friend class BTreeInstrumentation;
+
+	public:
+		scope(BTreeInstrumentation& instrumentation, operation kind);
+		scope(const scope&) = delete;
+		scope& operator=(const scope&) = delete;
+		~scope();
+	};
+
+private:
+	operation_statistics operations[3];
+	std::vector<std::function<void(trace_event, int)> > callbacks;
+
+public:
+	BTreeInstrumentation() {this->clear();}
+
+	void trace(trace_event event);
+	void add_trace_callback(std::function<void(trace_event, int)> callback);
+
+	const operation_statistics& statistics(operation kind) const;
+	void report(std::ostream& out) const;
+	void clear();
+};
+
+inline BTreeInstrumentation::scope*& BTreeInstrumentation::scope::innermost()
+{
+	static thread_local scope *current = nullptr;
+	return current;
+}
+
+//Scope of the thread's operation on given instrumentation that's being timed, nullptr if none
+inline BTreeInstrumentation::scope* BTreeInstrumentation::scope::outermost_of(const BTreeInstrumentation& instrumentation)
+{
+	scope *found = nullptr;
+	for (scope *tracker = innermost(); tracker != nullptr; tracker = tracker->enclosing)
+		if (&tracker->instrumentation == &instrumentation)
+			found = tracker;
+	return found;
+}
+
+inline BTreeInstrumentation::scope::scope(BTreeInstrumentation& instrumentation, operation kind) : instrumentation(instrumentation), kind(kind)
+{
+	this->outermost = outermost_of(instrumentation) == nullptr;
+	this->cascade_depth = 0;
+	this->enclosing = innermost();
+	innermost() = this;
+	if (this->outermost)
+		this->start = std::chrono::steady_clock::now();
+}
+
+inline BTreeInstrumentation::scope::~scope()
+{
+	innermost() = this->enclosing;
+	if (!this->outermost)
+		return;
+
+	long long elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - this->start).count();
+	int depth = this->cascade_depth;
+	operation_statistics& statistics = this->instrumentation.operations[(int)this->kind];
+
+	statistics.latency.record(elapsed);
+	if (depth > 0)
+		statistics.latency_with_cascade.record(elapsed);
+	statistics.cascade_depths[depth < max_cascade_depth ? depth : max_cascade_depth].fetch_add(1, std::memory_order_relaxed);
+}
+
+//Callbacks get the event and its position in the cascade of the current operation (1 for the first)
+inline void BTreeInstrumentation::trace(trace_event event)
+{
+	scope *operation_scope = scope::outermost_of(*this);
+	int depth = operation_scope != nullptr ? ++operation_scope->cascade_depth : 1;
+	for (int i=0; i < (int)this->callbacks.size(); i++)
+		this->callbacks[i](event, depth);
+}
+
+inline void BTreeInstrumentation::add_trace_callback(std::function<void(trace_event, int)> callback)
+{
+	this->callbacks.push_back(callback);
+}
+
+inline const BTreeInstrumentation::operation_statistics& BTreeInstrumentation::statistics(operation kind) const
+{
+	return this->operations[(int)kind];
+}
+
+//One line per operation, in nanoseconds:
+//insert count=1000 p50=120 p99=900 p999=4000 max=5200 cascade_count=37 cascade_p99=4100
+inline void BTreeInstrumentation::report(std::ostream& out) const
+{
+	const char *names[3] = {"insert", "remove", "search"};
+	for (int i=0; i < 3; i++)
+	{
+		const operation_statistics& statistics = this->operations[i];
+		out << names[i] << " count=" << statistics.latency.count()
+			<< " p50=" << statistics.latency.percentile(50)
+			<< " p99=" << statistics.latency.percentile(99)
+			<< " p999=" << statistics.latency.percentile(99.9)
+			<< " max=" << statistics.latency.max()
+			<< " cascade_count=" << statistics.latency_with_cascade.count()
+			<< " cascade_p99=" << statistics.latency_with_cascade.percentile(99) << std::endl;
+	}
+}
+
+inline void BTreeInstrumentation::clear()
+{
+	for (int i=0; i < 3; i++)
+	{
+		this->operations[i].latency.clear();
+		this->operations[i].latency_with_cascade.clear();
+		for (int j=0; j <= max_cascade_depth; j++)
+			this->operations[i].cascade_depths[j] = 0;
+	}
+}
+
+#endif
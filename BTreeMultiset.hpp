@@ -0,0 +1,242 @@
+#ifndef BTREE_MULTISET_HPP
+#define BTREE_MULTISET_HPP
+
+#include <utility>
+#include <vector>
+#include "BTree.hpp"
+
+//Sorted collection allowing duplicates on top of BTree<T>.
+//Every distinct key is stored once together with its number of occurrences,
+//so repeated keys don't make the tree any bigger.
+template <class T>
+class BTreeMultiset
+{
+	//Entries never change inside the tree, the count of a key is kept in counts[slot]
+	struct Entry
+	{
+		T key;
+		int slot;
+
+		bool operator<(const Entry& rhs) const {return this->key < rhs.key;}
+		bool operator==(const Entry& rhs) const {return this->key == rhs.key;}
+	};
+
+	BTree<Entry> entries;
+	std::vector<int> counts;
+	std::vector<int> free_slots;//slots of removed keys, reused by new ones
+	int data_length;
+	int distinct_count;
+
+	typename BTree<Entry>::const_iterator find_entry(const T& key) const;
+
+public:
+	//Visits every occurrence, so a key is repeated as many times as it was inserted
+	class const_iterator
+	{
+		typename BTree<Entry>::const_iterator position;
+		const std::vector<int> *counts;
+		int occurrence;
+
+		const_iterator(typename BTree<Entry>::const_iterator position, const std::vector<int> *counts) : position(position), counts(counts), occurrence(0) {}
+
+	public:
+		const_iterator() : counts(nullptr), occurrence(0) {}
+
+		const T& operator*() const;
+		const T* operator->() const;
+		const_iterator& operator++();
+		const_iterator operator++(int);
+
+		bool operator==(const const_iterator& rhs) const;
+		bool operator!=(const const_iterator& rhs) const;
+
+		friend class BTreeMultiset;
+	};
+
+	BTreeMultiset(int max_node_degree = 3) : entries(max_node_degree), data_length(0), distinct_count(0) {}
+
+	void insert(const T& key, int count = 1);
+	int remove(const T& key, int count = 1);
+	int remove_all(const T& key);
+	void clear();
+
+	int count(const T& key) const;
+	bool contains(const T& key) const;
+	std::pair<const_iterator, const_iterator> equal_range(const T& key) const;
+
+	const_iterator begin() const;
+	const_iterator end() const;
+
+	int length() const;
+	int distinct_length() const;
+	bool is_empty() const;
+};
+
+template <class T>
+typename BTree<typename BTreeMultiset<T>::Entry>::const_iterator BTreeMultiset<T>::find_entry(const T& key) const
+{
+	Entry entry = {key, -1};
+	return this->entries.find_from(typename BTree<Entry>::const_iterator(), entry);
+}
+
+template <class T>
+void BTreeMultiset<T>::insert(const T& key, int count)
+{
+	if (count < 1)
+		throw("Inserted count must be positive!");
+
+	typename BTree<Entry>::const_iterator position = this->find_entry(key);
+	this->data_length += count;
+	if (position != this->entries.end())
+	{
+		this->counts[position->slot] += count;
+		return;
+	}
+
+	Entry entry = {key, (int)this->counts.size()};
+	if (this->free_slots.empty())
+		this->counts.push_back(count);
+	else
+	{
+		entry.slot = this->free_slots.back();
+		this->free_slots.pop_back();
+		this->counts[entry.slot] = count;
+	}
+	this->entries.insert(entry);
+	this->distinct_count++;
+}
+
+//Removes at most count occurrences and returns how many were removed
+template <class T>
+int BTreeMultiset<T>::remove(const T& key, int count)
+{
+	typename BTree<Entry>::const_iterator position = this->find_entry(key);
+
+	if (position == this->entries.end() || count < 1)
+		return 0;
+
+	int slot = position->slot;
+	if (this->counts[slot] > count)
+	{
+		this->counts[slot] -= count;
+		this->data_length -= count;
+		return count;
+	}
+
+	count = this->counts[slot];
+	this->entries.remove(*position);
+	this->free_slots.push_back(slot);
+	this->data_length -= count;
+	this->distinct_count--;
+	return count;
+}
+
+template <class T>
+int BTreeMultiset<T>::remove_all(const T& key)
+{
+	return this->remove(key, this->count(key));
+}
+
+template <class T>
+void BTreeMultiset<T>::clear()
+{
+	this->entries.clear();
+	this->counts.clear();
+	this->free_slots.clear();
+	this->data_length = 0;
+	this->distinct_count = 0;
+}
+
+template <class T>
+int BTreeMultiset<T>::count(const T& key) const
+{
+	typename BTree<Entry>::const_iterator position = this->find_entry(key);
+	return position == this->entries.end() ? 0 : this->counts[position->slot];
+}
+
+template <class T>
+bool BTreeMultiset<T>::contains(const T& key) const
+{
+	return this->count(key) > 0;
+}
+
+//All occurrences of key are in [first, second), both are the first key greater than key if it doesn't exist
+template <class T>
+std::pair<typename BTreeMultiset<T>::const_iterator, typename BTreeMultiset<T>::const_iterator> BTreeMultiset<T>::equal_range(const T& key) const
+{
+	Entry entry = {key, -1};
+	const_iterator first(this->entries.lower_bound(entry), &this->counts);
+	const_iterator second = first;
+
+	if (first.position != this->entries.end() && first.position->key == key)
+		++second.position;
+	return std::make_pair(first, second);
+}
+
+template <class T>
+typename BTreeMultiset<T>::const_iterator BTreeMultiset<T>::begin() const
+{
+	return const_iterator(this->entries.begin(), &this->counts);
+}
+
+template <class T>
+typename BTreeMultiset<T>::const_iterator BTreeMultiset<T>::end() const
+{
+	return const_iterator(this->entries.end(), &this->counts);
+}
+
+template <class T>
+int BTreeMultiset<T>::length() const {return this->data_length;}
+
+template <class T>
+int BTreeMultiset<T>::distinct_length() const {return this->distinct_count;}
+
+template <class T>
+bool BTreeMultiset<T>::is_empty() const {return this->data_length == 0;}
+
+//Iterator functions start
+template <class T>
+const T& BTreeMultiset<T>::const_iterator::operator*() const
+{
+	return this->position->key;
+}
+
+template <class T>
+const T* BTreeMultiset<T>::const_iterator::operator->() const
+{
+	return &this->position->key;
+}
+
+template <class T>
+typename BTreeMultiset<T>::const_iterator& BTreeMultiset<T>::const_iterator::operator++()
+{
+	if (++this->occurrence >= (*this->counts)[this->position->slot])
+	{
+		++this->position;
+		this->occurrence = 0;
+	}
+	return *this;
+}
+
+template <class T>
+typename BTreeMultiset<T>::const_iterator BTreeMultiset<T>::const_iterator::operator++(int)
+{
+	const_iterator temp = *this;
+	++*this;
+	return temp;
+}
+
+template <class T>
+bool BTreeMultiset<T>::const_iterator::operator==(const const_iterator& rhs) const
+{
+	return this->position == rhs.position && this->occurrence == rhs.occurrence;
+}
+
+template <class T>
+bool BTreeMultiset<T>::const_iterator::operator!=(const const_iterator& rhs) const
+{
+	return !(*this == rhs);
+}
+//Iterator functions end
+
+#endif
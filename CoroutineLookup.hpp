@@ -0,0 +1,182 @@
+#ifndef COROUTINE_LOOKUP_HPP
+#define COROUTINE_LOOKUP_HPP
+
+//Lookups as C++20 coroutines: a lookup suspends whenever it needs a node that isn't
+//ready yet, so a single thread can keep hundreds of them in flight.
+//Only available when the compiler supports coroutines (BTREE_COROUTINES is defined then).
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <chrono>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+
+#define BTREE_COROUTINES
+
+//Returned by BTree::co_search. The lookup starts immediately and runs until its first
+//fetch that has to wait, result() is valid once done() is true.
+class LookupTask
+{
+public:
+	struct promise_type
+	{
+		bool result = false;
+		std::exception_ptr exception;
+
+		LookupTask get_return_object() {return LookupTask(std::coroutine_handle<promise_type>::from_promise(*this));}
+		std::suspend_never initial_suspend() noexcept {return {};}
+		std::suspend_always final_suspend() noexcept {return {};}//frame is kept until the task is destroyed
+		void return_value(bool value) {this->result = value;}
+		void unhandled_exception() {this->exception = std::current_exception();}
+	};
+
+private:
+	std::coroutine_handle<promise_type> handle;
+
+	LookupTask(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+public:
+	LookupTask(const LookupTask&) = delete;
+	LookupTask& operator=(const LookupTask&) = delete;
+	LookupTask(LookupTask&& task) : handle(std::exchange(task.handle, nullptr)) {}
+	LookupTask& operator=(LookupTask&& task);
+	~LookupTask()
+	{
+		if (this->handle)
+			this->handle.destroy();
+	}
+
+	bool done() const;
+	bool result() const;
+};
+
+inline LookupTask& LookupTask::operator=(LookupTask&& task)
+{
+	if (this != &task)
+	{
+		if (this->handle)
+			this->handle.destroy();
+		this->handle = std::exchange(task.handle, nullptr);
+	}
+	return *this;
+}
+
+inline bool LookupTask::done() const
+{
+	return this->handle && this->handle.done();
+}
+
+inline bool LookupTask::result() const
+{
+	if (!this->done())
+		throw("Lookup is not finished yet!");
+	if (this->handle.promise().exception)
+		std::rethrow_exception(this->handle.promise().exception);
+	return this->handle.promise().result;
+}
+
+//Page provider that pretends every node is a page on slow storage: the first fetch of a
+//page completes after the given latency, later fetches of it are immediate.
+//With zero latency a fetch only prefetches the node and lets the other lookups run,
+//which hides cache misses of in memory trees.
+//Suspended lookups are resumed by run(), in the order their pages become ready.
+class SimulatedPageProvider
+{
+	typedef std::chrono::steady_clock clock;
+
+	struct waiting_lookup
+	{
+		clock::time_point ready_time;
+		std::coroutine_handle<> handle;
+	};
+
+	clock::duration latency;
+	bool keep_pages;
+	std::unordered_set<const void*> resident_pages;
+	std::deque<waiting_lookup> waiting;//ready times are ascending, latency is the same for all
+	long fetch_count;
+	long miss_count;
+
+public:
+	class fetch_awaiter
+	{
+		SimulatedPageProvider& provider;
+		const void *page;
+
+	public:
+		fetch_awaiter(SimulatedPageProvider& provider, const void *page) : provider(provider), page(page) {}
+
+		bool await_ready() const;
+		void await_suspend(std::coroutine_handle<> handle);
+		void await_resume();
+	};
+
+	SimulatedPageProvider(clock::duration latency = clock::duration::zero(), bool keep_pages = true)
+		: latency(latency), keep_pages(keep_pages), fetch_count(0), miss_count(0) {}
+
+	fetch_awaiter fetch(const void *page);
+	void run();
+	void evict_all();
+
+	long fetches() const;
+	long misses() const;
+	bool is_idle() const;
+};
+
+inline bool SimulatedPageProvider::fetch_awaiter::await_ready() const
+{
+	this->provider.fetch_count++;
+	return this->provider.latency != clock::duration::zero() && this->provider.resident_pages.count(this->page) > 0;
+}
+
+inline void SimulatedPageProvider::fetch_awaiter::await_suspend(std::coroutine_handle<> handle)
+{
+#ifdef __GNUC__
+	__builtin_prefetch(this->page);
+#endif
+	this->provider.miss_count++;
+	this->provider.waiting.push_back({clock::now() + this->provider.latency, handle});
+}
+
+inline void SimulatedPageProvider::fetch_awaiter::await_resume()
+{
+	if (this->provider.keep_pages && this->provider.latency != clock::duration::zero())
+		this->provider.resident_pages.insert(this->page);
+}
+
+inline SimulatedPageProvider::fetch_awaiter SimulatedPageProvider::fetch(const void *page)
+{
+	return fetch_awaiter(*this, page);
+}
+
+//Resumes waiting lookups until all of them are finished
+inline void SimulatedPageProvider::run()
+{
+	while (!this->waiting.empty())
+	{
+		waiting_lookup next = this->waiting.front();
+		this->waiting.pop_front();
+
+		if (clock::now() < next.ready_time)
+			std::this_thread::sleep_until(next.ready_time);
+		next.handle.resume();
+	}
+}
+
+inline void SimulatedPageProvider::evict_all()
+{
+	this->resident_pages.clear();
+}
+
+inline long SimulatedPageProvider::fetches() const {return this->fetch_count;}
+
+inline long SimulatedPageProvider::misses() const {return this->miss_count;}
+
+inline bool SimulatedPageProvider::is_idle() const {return this->waiting.empty();}
+
+#endif
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef EPOCH_RECLAIMER_HPP
+#define EPOCH_RECLAIMER_HPP
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Epoch based reclamation: objects unlinked from a shared structure are retired instead of
+//deleted, and freed only when no reader can still hold a pointer to them.
+//Readers keep a guard alive while they traverse:
+//	EpochReclaimer::guard guard(reclaimer);
+//Every guard records the global epoch it started in. Objects retired in epoch e are freed
+//once the global epoch reaches e+2, and the epoch only moves forward when every active
+//guard has seen the current one, so readers never pay more than one slot update.
+//It only keeps retired memory alive: the structure itself still has to be safe to read
+//next to its writers.
+class EpochReclaimer
+{
+	struct retired_object
+	{
+		void *pointer;
+		void (*deleter)(void*);
+		unsigned long epoch;
+	};
+
+	std::atomic<unsigned long> global_epoch;
+	std::vector<std::atomic<unsigned long> > reader_epochs;//0 means the slot is free
+
+	mutable std::mutex retired_mutex;
+	std::vector<retired_object> retired;
+	int collect_threshold;
+
+	bool try_advance();
+	int free_retired(bool all);
+
+public:
+	class guard
+	{
+		EpochReclaimer& reclaimer;
+		int slot;
+
+	public:
+		guard(EpochReclaimer& reclaimer);
+		guard(const guard&) = delete;
+		guard& operator=(const guard&) = delete;
+		~guard();
+	};
+
+	EpochReclaimer(int max_readers = 128, int collect_threshold = 64);
+	EpochReclaimer(const EpochReclaimer&) = delete;
+	EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+	~EpochReclaimer();
+
+	template <class T>
+	void retire(T *object);
+	int collect();
+
+	int pending() const;
+	unsigned long epoch() const;
+};
+
+//Slot search starts from a per thread position, so concurrent readers rarely meet
+inline EpochReclaimer::guard::guard(EpochReclaimer& reclaimer) : reclaimer(reclaimer)
+{
+	int slot_count = reclaimer.reader_epochs.size();
+	int start = std::hash<std::thread::id>()(std::this_thread::get_id()) % slot_count;
+	unsigned long epoch = reclaimer.global_epoch.load();
+
+	for (int i=0; i < slot_count; i++)
+	{
+		this->slot = (start+i) % slot_count;
+		unsigned long expected = 0;
+		if (reclaimer.reader_epochs[this->slot].compare_exchange_strong(expected, epoch))
+			return;
+	}
+	throw("Epoch reclaimer has no free reader slot!");
+}
+
+inline EpochReclaimer::guard::~guard()
+{
+	this->reclaimer.reader_epochs[this->slot].store(0);
+}
+
+inline EpochReclaimer::EpochReclaimer(int max_readers, int collect_threshold) : global_epoch(1), reader_epochs(max_readers)
+{
+	if (max_readers < 1)
+		throw("Epoch reclaimer needs at least one reader slot!");
+
+	for (int i=0; i < max_readers; i++)
+		this->reader_epochs[i].store(0);
+	this->collect_threshold = collect_threshold;
+}
+
+//No guard may be alive anymore, everything retired is freed
+inline EpochReclaimer::~EpochReclaimer()
+{
+	this->free_retired(true);
+}
+
+template <class T>
+void EpochReclaimer::retire(T *object)
+{
+	if (object == nullptr)
+		return;
+
+	bool full;
+	{
+		std::lock_guard<std::mutex> lock(this->retired_mutex);
+		this->retired.push_back({object, [](void *pointer) {delete static_cast<T*>(pointer);}, this->global_epoch.load()});
+		full = (int)this->retired.size() >= this->collect_threshold;
+	}
+	if (full)
+		this->collect();
+}
+
+//Tries to move the epoch forward and frees what is safe, returns the number freed
+inline int EpochReclaimer::collect()
+{
+	this->try_advance();
+	return this->free_retired(false);
+}
+
+inline bool EpochReclaimer::try_advance()
+{
+	unsigned long epoch = this->global_epoch.load();
+	for (int i=0; i < (int)this->reader_epochs.size(); i++)
+	{
+		unsigned long reader_epoch = this->reader_epochs[i].load();
+		if (reader_epoch != 0 && reader_epoch != epoch)
+			return false;
+	}
+	return this->global_epoch.compare_exchange_strong(epoch, epoch+1);
+}
+
+inline int EpochReclaimer::free_retired(bool all)
+{
+	std::vector<retired_object> freed;
+	{
+		std::lock_guard<std::mutex> lock(this->retired_mutex);
+		unsigned long epoch = this->global_epoch.load();
+		int kept = 0;
+		for (int i=0; i < (int)this->retired.size(); i++)
+		{
+			if (all || this->retired[i].epoch+2 <= epoch)
+				freed.push_back(this->retired[i]);
+			else
+				this->retired[kept++] = this->retired[i];
+		}
+		this->retired.resize(kept);
+	}
+
+	for (int i=0; i < (int)freed.size(); i++)
+		freed[i].deleter(freed[i].pointer);
+	return freed.size();
+}
+
+inline int EpochReclaimer::pending() const
+{
+	std::lock_guard<std::mutex> lock(this->retired_mutex);
+	return this->retired.size();
+}
+
+inline unsigned long EpochReclaimer::epoch() const {return this->global_epoch.load();}
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef FROZEN_BTREE_HPP
+#define FROZEN_BTREE_HPP
+
+#include <vector>
+
+//Immutable snapshot of a B-Tree for read-only serving.
+//Keys live in a single array in Eytzinger (BFS) order: children of slot k are
+//slots 2k and 2k+1, so the search needs no pointers and no unpredictable branches.
+template <class T>
+class FrozenBTree
+{
+	std::vector<T> layout;
+	int data_length;
+
+	void build(const std::vector<T>& sorted_data, int& position, int slot);
+	int lower_bound_slot(const T& data) const;
+
+public:
+	FrozenBTree() : layout(1), data_length(0) {}
+	FrozenBTree(const std::vector<T>& sorted_data);
+
+	bool contains(const T& data) const;
+	const T* lower_bound(const T& data) const;
+
+	void to_sorted_list(std::vector<T>& out) const;
+
+	int length() const;
+	bool is_empty() const;
+	int memory_usage() const;
+};
+
+template <class T>
+FrozenBTree<T>::FrozenBTree(const std::vector<T>& sorted_data) : layout(sorted_data.size()+1), data_length(sorted_data.size())
+{
+	for (int i=1; i < this->data_length; i++)
+		if (!(sorted_data[i-1] < sorted_data[i]))
+			throw("Frozen B-Tree needs strictly ascending data!");
+
+	int position = 0;
+	this->build(sorted_data, position, 1);
+}
+
+template <class T>
+void FrozenBTree<T>::build(const std::vector<T>& sorted_data, int& position, int slot)
+{
+	if (slot > this->data_length)
+		return;
+
+	this->build(sorted_data, position, 2*slot);
+	this->layout[slot] = sorted_data[position++];
+	this->build(sorted_data, position, 2*slot+1);
+}
+
+template <class T>
+int FrozenBTree<T>::lower_bound_slot(const T& data) const
+{
+	int slot = 1;
+	while (slot <= this->data_length)
+	{
+#if defined(__GNUC__)
+		//Slots 16k...16k+15 are the descendants four levels down, usually one cache line.
+		//Near the bottom they are past the array, where even forming the pointer is undefined.
+		if (16*(long long)slot < (long long)this->layout.size())
+			__builtin_prefetch(this->layout.data() + 16*slot);
+#endif
+		slot = 2*slot + (this->layout[slot] < data);
+	}
+
+	//Drop the trailing right turns and the last left turn to get back to the answer
+	while (slot & 1)
+		slot >>= 1;
+	return slot >> 1;
+}
+
+template <class T>
+bool FrozenBTree<T>::contains(const T& data) const
+{
+	int slot = this->lower_bound_slot(data);
+	return slot != 0 && this->layout[slot] == data;
+}
+
+template <class T>
+const T* FrozenBTree<T>::lower_bound(const T& data) const
+{
+	int slot = this->lower_bound_slot(data);
+	if (slot == 0)
+		return nullptr;
+	return &this->layout[slot];
+}
+
+template <class T>
+void FrozenBTree<T>::to_sorted_list(std::vector<T>& out) const
+{
+	//Inorder walk of the implicit tree without recursion
+	int slot = 1;
+	while (2*slot <= this->data_length)
+		slot *= 2;
+
+	for (int i=0; i < this->data_length; i++)
+	{
+		out.push_back(this->layout[slot]);
+		if (2*slot+1 <= this->data_length)
+		{
+			slot = 2*slot+1;
+			while (2*slot <= this->data_length)
+				slot *= 2;
+		}
+		else
+		{
+			while (slot & 1)
+				slot >>= 1;
+			slot >>= 1;
+		}
+	}
+}
+
+template <class T>
+int FrozenBTree<T>::length() const {return this->data_length;}
+
+template <class T>
+bool FrozenBTree<T>::is_empty() const {return this->data_length == 0;}
+
+template <class T>
+int FrozenBTree<T>::memory_usage() const
+{
+	return sizeof(FrozenBTree<T>) + this->layout.capacity()*sizeof(T);
+}
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef INTRUSIVE_LIST_HPP
+#define INTRUSIVE_LIST_HPP
+
+//Link fields stored inside the listed objects themselves:
+//	class Job : public IntrusiveListHook<Job> { ... };
+//	IntrusiveList<Job> jobs;
+//The list never allocates or deletes, it only links objects the user owns.
+//Tag lets an object derive several hooks and be in several lists at once.
+template <class T, class Tag = void>
+class IntrusiveListHook
+{
+	T *prev;
+	T *next;
+	bool linked;
+
+public:
+	IntrusiveListHook() : prev(nullptr), next(nullptr), linked(false) {}
+	IntrusiveListHook(const IntrusiveListHook&) : IntrusiveListHook() {}
+	IntrusiveListHook& operator=(const IntrusiveListHook&) {return *this;}
+
+	bool is_linked() const {return this->linked;}
+
+	template <class U, class V> friend class IntrusiveList;
+};
+
+template <class T, class Tag = void>
+class IntrusiveList
+{
+	typedef IntrusiveListHook<T, Tag> Hook;
+
+	T *head;
+	T *tail;
+	int list_length;
+
+	static Hook* hook(T *item) {return static_cast<Hook*>(item);}
+
+public:
+	IntrusiveList() : head(nullptr), tail(nullptr), list_length(0) {}
+	IntrusiveList(const IntrusiveList&) = delete;
+	IntrusiveList& operator=(const IntrusiveList&) = delete;
+	~IntrusiveList() {this->clear();}
+
+	void insert_after(T *item, T *node = nullptr);
+	void push_back(T *item);
+	void remove(T *item);
+	T* pop_front();
+	T* pop_back();
+	void clear();
+
+	T* get_head() const;
+	T* get_tail() const;
+	static T* get_next(T *item);
+	static T* get_prev(T *item);
+
+	bool contains(T *item) const;
+	bool is_empty() const;
+
+	const int& length() const;
+};
+
+template <class T, class Tag>
+void IntrusiveList<T, Tag>::insert_after(T *item, T *node)
+{
+	if (hook(item)->linked)
+		throw("Item is already in a list!");
+
+	Hook *inserted = hook(item);
+	inserted->prev = node;
+	inserted->next = node == nullptr ? this->head : hook(node)->next;
+	inserted->linked = true;
+
+	if (inserted->next != nullptr)
+		hook(inserted->next)->prev = item;
+	else
+		this->tail = item;
+
+	if (node != nullptr)
+		hook(node)->next = item;
+	else
+		this->head = item;
+
+	this->list_length++;
+}
+
+template <class T, class Tag>
+void IntrusiveList<T, Tag>::push_back(T *item)
+{
+	this->insert_after(item, this->tail);
+}
+
+template <class T, class Tag>
+void IntrusiveList<T, Tag>::remove(T *item)
+{
+	Hook *removed = hook(item);
+	if (!removed->linked)
+		throw("Item is not in a list!");
+
+	if (removed->prev != nullptr)
+		hook(removed->prev)->next = removed->next;
+	else
+		this->head = removed->next;
+
+	if (removed->next != nullptr)
+		hook(removed->next)->prev = removed->prev;
+	else
+		this->tail = removed->prev;
+
+	removed->prev = removed->next = nullptr;
+	removed->linked = false;
+	this->list_length--;
+}
+
+template <class T, class Tag>
+T* IntrusiveList<T, Tag>::pop_front()
+{
+	T *temp = this->head;
+	if (temp != nullptr)
+		this->remove(temp);
+	return temp;
+}
+
+template <class T, class Tag>
+T* IntrusiveList<T, Tag>::pop_back()
+{
+	T *temp = this->tail;
+	if (temp != nullptr)
+		this->remove(temp);
+	return temp;
+}
+
+template <class T, class Tag>
+void IntrusiveList<T, Tag>::clear()
+{
+	while (!this->is_empty())
+		this->pop_front();
+}
+
+template <class T, class Tag>
+T* IntrusiveList<T, Tag>::get_head() const {return this->head;}
+
+template <class T, class Tag>
+T* IntrusiveList<T, Tag>::get_tail() const {return this->tail;}
+
+template <class T, class Tag>
+T* IntrusiveList<T, Tag>::get_next(T *item) {return hook(item)->next;}
+
+template <class T, class Tag>
+T* IntrusiveList<T, Tag>::get_prev(T *item) {return hook(item)->prev;}
+
+template <class T, class Tag>
+bool IntrusiveList<T, Tag>::contains(T *item) const
+{
+	T *tracker = this->head;
+	while (tracker != nullptr)
+	{
+		if (tracker == item)
+			return true;
+		tracker = hook(tracker)->next;
+	}
+	return false;
+}
+
+template <class T, class Tag>
+bool IntrusiveList<T, Tag>::is_empty() const {return this->head == nullptr;}
+
+template <class T, class Tag>
+const int& IntrusiveList<T, Tag>::length() const {return this->list_length;}
+
+#endif
@@ -30,19 +30,20 @@ public:
 		void bind_next_plus(Node *given_next);
 		Node* unbind_next();
 
-		virtual Node& operator=(const Node& rhs);
+		Node& operator=(const Node& rhs);
 
 		friend class LinkedList;
 	};
 
 private:
 	Node *head;
+	Node *tail;
 
 protected:
 	int list_length;
 	
 public:
-	LinkedList() {this->head = nullptr; this->list_length = 0;}
+	LinkedList() {this->head = nullptr; this->tail = nullptr; this->list_length = 0;}
 	LinkedList(const LinkedList& list) : LinkedList() {*this = list;}
 	virtual ~LinkedList()
 	{
@@ -55,9 +56,18 @@ public:
 
 	void insert_at(T data, int index);
 	void insert_after(T data, Node *node = nullptr);
+	void insert_after_unchecked(T data, Node *node);
+	void push_back(T data);
+	void pop_back();
 	void insert_node_at(Node *node, int index);
 	void insert_node_after(Node *inserted, Node *node2);
 
+	template <class InputIt>
+	void assign(InputIt first, InputIt last);
+	void splice_back(LinkedList& other);
+	void splice_front(LinkedList& other);
+	void split_at(int index, LinkedList& rest);
+
 	void remove(T data);
 	void remove_at(int index);
 	void remove_node(Node *node);
@@ -71,6 +81,7 @@ public:
 	Node* get_prev_of_node(Node *node) const;
 	Node* get_prev_of_data(T data) const;
 	Node* get_index(int index) const;
+	Node* get_tail() const;
 
 	bool contains(Node* node) const;
 	bool is_empty() const;
@@ -155,14 +166,10 @@ void LinkedList<T>::insert_at(T data, int index)
 		throw("Cannot insert element at given index! Index out of range.");
 	else if (index == 0)
 		this->insert_after(data);
+	else if (index == this->length())
+		this->push_back(data);
 	else
-	{
-		Node *tracker = this->get_index(index-1);
-		Node *temp = new Node(data, tracker->get_next());
-		tracker->release_next();
-		tracker->bind_next(temp);
-		this->list_length++;
-	}
+		this->insert_after_unchecked(data, this->get_index(index-1));
 }
 
 template <class T>
@@ -174,6 +181,8 @@ void LinkedList<T>::insert_after(T data, typename LinkedList<T>::Node *node)
 	{
 		Node *temp = this->head;
 		this->head = new Node(data, temp);
+		if (this->tail == nullptr)
+			this->tail = this->head;
 		this->list_length++;
 		return;
 	}
@@ -186,12 +195,49 @@ void LinkedList<T>::insert_after(T data, typename LinkedList<T>::Node *node)
 		{
 			temp = new Node(data, tracker->release_next());
 			tracker->bind_next(temp);
+			if (tracker == this->tail)
+				this->tail = temp;
 			this->list_length++;
 			return;
 		}
 	}
 }
 
+//Caller guarantees that node is in this list, so no linear validation is done
+template <class T>
+void LinkedList<T>::insert_after_unchecked(T data, typename LinkedList<T>::Node *node)
+{
+	if (node == nullptr)
+		return this->insert_after(data);
+
+	Node *temp = new Node(data, node->release_next());
+	node->bind_next(temp);
+	if (node == this->tail)
+		this->tail = temp;
+	this->list_length++;
+}
+
+template <class T>
+void LinkedList<T>::push_back(T data)
+{
+	if (this->tail == nullptr)
+		return this->insert_after(data);
+
+	Node *temp = new Node(data);
+	this->tail->bind_next(temp);
+	this->tail = temp;
+	this->list_length++;
+}
+
+//Singly linked, so the new tail is found by a walk from head
+template <class T>
+void LinkedList<T>::pop_back()
+{
+	if (this->is_empty())
+		throw("Empty linked list cannot delete an element!");
+	this->remove_at(this->length()-1);
+}
+
 template <class T>
 void LinkedList<T>::insert_node_at(typename LinkedList<T>::Node *node, int index)
 {
@@ -201,13 +247,17 @@ void LinkedList<T>::insert_node_at(typename LinkedList<T>::Node *node, int index
 	{
 		node->bind_next(this->head);
 		this->head = node;
+		if (this->tail == nullptr)
+			this->tail = node;
 		this->list_length++;
 	}
 	else
 	{
-		Node *tracker = this->get_index(index-1);
+		Node *tracker = index == this->length() ? this->tail : this->get_index(index-1);
 		node->bind_next(tracker->release_next());
 		tracker->bind_next(node);
+		if (tracker == this->tail)
+			this->tail = node;
 		this->list_length++;
 	}
 }
@@ -219,25 +269,97 @@ void LinkedList<T>::insert_node_after(typename LinkedList<T>::Node *inserted, ty
 	{
 		inserted->bind_next(node->release_next());
 		node->bind_next(inserted);
+		if (node == this->tail)
+			this->tail = inserted;
 		this->list_length++;
 	}
 	else
 		throw("Given node doesn't exist!");
 }
 
+template <class T>
+template <class InputIt>
+void LinkedList<T>::assign(InputIt first, InputIt last)
+{
+	this->clear();
+	for (; first != last; ++first)
+		this->push_back(*first);
+}
+
+//Moves every node of other to the end of this list without copying
+template <class T>
+void LinkedList<T>::splice_back(LinkedList& other)
+{
+	if (this == &other || other.is_empty())
+		return;
+
+	if (this->is_empty())
+		this->head = other.head;
+	else
+		this->tail->bind_next(other.head);
+
+	this->tail = other.tail;
+	this->list_length += other.list_length;
+	other.head = other.tail = nullptr;
+	other.list_length = 0;
+}
+
+//Moves every node of other to the beginning of this list without copying
+template <class T>
+void LinkedList<T>::splice_front(LinkedList& other)
+{
+	if (this == &other || other.is_empty())
+		return;
+
+	if (this->is_empty())
+		this->tail = other.tail;
+	else
+		other.tail->bind_next(this->head);
+
+	this->head = other.head;
+	this->list_length += other.list_length;
+	other.head = other.tail = nullptr;
+	other.list_length = 0;
+}
+
+//Moves elements from given index to the end into the end of rest, walking the list once
+template <class T>
+void LinkedList<T>::split_at(int index, LinkedList& rest)
+{
+	if (index > this->length() || index < 0)
+		throw("Cannot split list at given index! Index out of range.");
+	else if (this == &rest)
+		throw("List cannot be split into itself!");
+	else if (index == this->length())
+		return;
+
+	LinkedList moved;
+	if (index == 0)
+	{
+		moved.head = this->head;
+		moved.tail = this->tail;
+		this->head = this->tail = nullptr;
+	}
+	else
+	{
+		Node *tracker = this->get_index(index-1);
+		moved.head = tracker->release_next();
+		moved.tail = this->tail;
+		this->tail = tracker;
+	}
+	moved.list_length = this->list_length - index;
+	this->list_length = index;
+
+	rest.splice_back(moved);
+}
+
 template <class T>
 void LinkedList<T>::remove(T data)
 {
 	if (this->is_empty())
 		throw("Empty linked list cannot delete an element!");
 	else if (this->head->data == data)
-	{
-		Node *temp = this->head;
-		this->head = this->head->get_next();
-		delete temp;
-		this->list_length--;
-		return;
-	}
+		return this->remove_at(0);
 
 	Node *tracker = this->get_prev_of_data(data);
 
@@ -248,6 +370,8 @@ void LinkedList<T>::remove(T data)
 		Node *temp = tracker->unbind_next();
 		if (temp != nullptr)
 		{
+			if (temp == this->tail)
+				this->tail = tracker;
 			delete temp;
 			this->list_length--;
 		}
@@ -264,16 +388,20 @@ void LinkedList<T>::remove_at(int index)
 	{
 		Node *temp = this->head;
 		this->head = this->head->get_next();
+		if (this->head == nullptr)
+			this->tail = nullptr;
 		delete temp;
 		this->list_length--;
 	}
 	else
 	{
 		Node *tracker = this->get_index(index-1);
-		tracker = tracker->unbind_next();
-		if (tracker != nullptr)
+		Node *temp = tracker->unbind_next();
+		if (temp != nullptr)
 		{
-			delete tracker;
+			if (temp == this->tail)
+				this->tail = tracker;
+			delete temp;
 			this->list_length--;
 		}
 	}
@@ -293,6 +421,8 @@ void LinkedList<T>::remove_node(typename LinkedList<T>::Node* node)
 		throw("Given node does not exist in given linked list!");
 	else
 	{
+		if (node == this->tail)
+			this->tail = tracker;
 		delete tracker->unbind_next();
 		this->list_length--;
 		return;
@@ -318,6 +448,8 @@ typename LinkedList<T>::Node* LinkedList<T>::extract_node_at(int index)
 	{
 		Node *temp = this->head;
 		this->head = this->head->get_next();
+		if (this->head == nullptr)
+			this->tail = nullptr;
 		temp->release_next();
 		this->list_length--;
 		return temp;
@@ -327,6 +459,8 @@ typename LinkedList<T>::Node* LinkedList<T>::extract_node_at(int index)
 
 	if (tracker->next != nullptr)
 	{
+		if (tracker->next == this->tail)
+			this->tail = tracker;
 		this->list_length--;
 		return tracker->unbind_next();
 	}
@@ -344,9 +478,12 @@ typename LinkedList<T>::Node* LinkedList<T>::extract_node_after(typename LinkedL
 		if (node->get_next() == nullptr)
 			return nullptr;
 
+		if (node->get_next() == this->tail)
+			this->tail = node;
 		this->list_length--;
 		return node->unbind_next();
 	}
+	return nullptr;
 }
 
 template <class T>
@@ -427,6 +564,9 @@ typename LinkedList<T>::Node* LinkedList<T>::get_index(int index) const
 	return tracker;
 }
 
+template <class T>
+typename LinkedList<T>::Node* LinkedList<T>::get_tail() const {return this->tail;}
+
 template <class T>
 bool LinkedList<T>::contains(typename LinkedList<T>::Node* node) const
 {
@@ -505,6 +645,7 @@ LinkedList<T>& LinkedList<T>::operator=(const LinkedList<T>& rhs)
 			this->list_length++;
 			tracker = tracker->get_next();
 		}
+		this->tail = creater;
 	}
 	return *this;
 }
@@ -0,0 +1,218 @@
+#ifndef PACKED_INT_BLOCK_HPP
+#define PACKED_INT_BLOCK_HPP
+
+#include <type_traits>
+#include <vector>
+#include "LinkedList.hpp"
+
+//Sorted integer keys of a single node, frame-of-reference encoded.
+//Every key is stored as its distance from the smallest key, bit-packed into
+//the minimum width needed for the block.
+template <class T>
+class PackedIntBlock
+{
+	static_assert(std::is_integral<T>::value, "PackedIntBlock needs an integral key type!");
+	typedef typename std::make_unsigned<T>::type U;
+
+	static const int decode_batch = 64;
+
+	T base;
+	int bits;
+	int count;
+	std::vector<unsigned long long> words;
+
+	unsigned long long get_offset(int index) const;
+	void decode_range(int first, int length, U* out) const;
+
+public:
+	PackedIntBlock() : base(0), bits(0), count(0) {}
+	PackedIntBlock(const std::vector<T>& sorted_keys) : PackedIntBlock() {this->assign(sorted_keys);}
+	PackedIntBlock(const LinkedList<T>& sorted_keys) : PackedIntBlock() {this->assign(sorted_keys);}
+
+	void assign(const std::vector<T>& sorted_keys);
+	void assign(const LinkedList<T>& sorted_keys);
+	void clear();
+
+	int lower_bound(T key) const;
+	int find(T key) const;
+	bool contains(T key) const;
+
+	T get_index(int index) const;
+	void decode(std::vector<T>& out) const;
+
+	int length() const;
+	int bit_width() const;
+	bool is_empty() const;
+	int memory_usage() const;
+};
+
+template <class T>
+void PackedIntBlock<T>::assign(const std::vector<T>& sorted_keys)
+{
+	this->clear();
+	if (sorted_keys.empty())
+		return;
+
+	for (int i=1; i < (int)sorted_keys.size(); i++)
+		if (!(sorted_keys[i-1] < sorted_keys[i]))
+			throw("Packed block needs strictly ascending keys!");
+
+	this->base = sorted_keys.front();
+	this->count = sorted_keys.size();
+
+	unsigned long long range = (U)sorted_keys.back() - (U)this->base;
+	while (this->bits < 64 && (range >> this->bits) != 0)
+		this->bits++;
+
+	//One extra word so that a value crossing the last word boundary can be read in one go
+	this->words.assign(((long long)this->count*this->bits + 63)/64 + 1, 0);
+
+	for (int i=0; i < this->count; i++)
+	{
+		unsigned long long offset = (U)sorted_keys[i] - (U)this->base;
+		long long position = (long long)i*this->bits;
+		int shift = position % 64;
+
+		this->words[position/64] |= offset << shift;
+		if (shift != 0 && shift + this->bits > 64)
+			this->words[position/64 + 1] |= offset >> (64 - shift);
+	}
+}
+
+template <class T>
+void PackedIntBlock<T>::assign(const LinkedList<T>& sorted_keys)
+{
+	std::vector<T> keys;
+	keys.reserve(sorted_keys.length());
+
+	if (!sorted_keys.is_empty())
+	{
+		typename LinkedList<T>::Node* tracker = sorted_keys.get_index(0);
+		while (tracker != nullptr)
+		{
+			keys.push_back(tracker->get_data());
+			tracker = tracker->get_next();
+		}
+	}
+	this->assign(keys);
+}
+
+template <class T>
+void PackedIntBlock<T>::clear()
+{
+	this->base = 0;
+	this->bits = 0;
+	this->count = 0;
+	this->words.clear();
+}
+
+template <class T>
+unsigned long long PackedIntBlock<T>::get_offset(int index) const
+{
+	if (this->bits == 0)
+		return 0;
+
+	long long position = (long long)index*this->bits;
+	int shift = position % 64;
+	unsigned long long value = this->words[position/64] >> shift;
+
+	if (shift != 0 && shift + this->bits > 64)
+		value |= this->words[position/64 + 1] << (64 - shift);
+	if (this->bits < 64)
+		value &= (1ULL << this->bits) - 1;
+	return value;
+}
+
+template <class T>
+void PackedIntBlock<T>::decode_range(int first, int length, U* out) const
+{
+	for (int i=0; i < length; i++)
+		out[i] = (U)this->base + (U)this->get_offset(first+i);
+}
+
+template <class T>
+int PackedIntBlock<T>::lower_bound(T key) const
+{
+	if (this->count == 0 || key <= this->base)
+		return 0;
+
+	//Compare against the offset from base, so the search works on unsigned values
+	U target = (U)key - (U)this->base;
+
+	//Binary search for the last batch whose first key is smaller, the answer is inside it
+	//or right behind it. The first batch always qualifies since its first key is the base.
+	int low = 0, high = (this->count-1)/decode_batch;
+	while (low < high)
+	{
+		int middle = low + (high-low+1)/2;
+		if ((U)this->get_offset(middle*decode_batch) < target)
+			low = middle;
+		else
+			high = middle-1;
+	}
+
+	int first = low*decode_batch;
+	int length = this->count - first < decode_batch ? this->count - first : decode_batch;
+	U decoded[decode_batch];
+	for (int i=0; i < length; i++)
+		decoded[i] = (U)this->get_offset(first+i);
+
+	//Branch free counting loop, which compilers turn into vector compares
+	int smaller = 0;
+	for (int i=0; i < length; i++)
+		smaller += decoded[i] < target;
+	return first + smaller;
+}
+
+template <class T>
+int PackedIntBlock<T>::find(T key) const
+{
+	int index = this->lower_bound(key);
+	if (index < this->count && this->get_index(index) == key)
+		return index;
+	return -1;
+}
+
+template <class T>
+bool PackedIntBlock<T>::contains(T key) const {return this->find(key) != -1;}
+
+template <class T>
+T PackedIntBlock<T>::get_index(int index) const
+{
+	if (index < 0 || index >= this->count)
+		throw("Index out of scope!");
+	return (T)((U)this->base + (U)this->get_offset(index));
+}
+
+template <class T>
+void PackedIntBlock<T>::decode(std::vector<T>& out) const
+{
+	int start = out.size();
+	out.resize(start + this->count);
+
+	U decoded[decode_batch];
+	for (int first=0; first < this->count; first += decode_batch)
+	{
+		int length = this->count - first < decode_batch ? this->count - first : decode_batch;
+		this->decode_range(first, length, decoded);
+		for (int i=0; i < length; i++)
+			out[start+first+i] = (T)decoded[i];
+	}
+}
+
+template <class T>
+int PackedIntBlock<T>::length() const {return this->count;}
+
+template <class T>
+int PackedIntBlock<T>::bit_width() const {return this->bits;}
+
+template <class T>
+bool PackedIntBlock<T>::is_empty() const {return this->count == 0;}
+
+template <class T>
+int PackedIntBlock<T>::memory_usage() const
+{
+	return sizeof(PackedIntBlock<T>) + this->words.capacity()*sizeof(unsigned long long);
+}
+
+#endif
@@ -0,0 +1,435 @@
+#ifndef PARTITIONED_BTREE_HPP
+#define PARTITIONED_BTREE_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BTree.hpp"
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+//Range partitioned front end over several BTree<T>, one per partition.
+//Partitions are spread over the NUMA nodes of the machine. Every partition has a long
+//lived worker thread pinned to the CPUs of its NUMA node, and every change of the tree
+//runs on it, so (with the first touch policy of the OS and per thread malloc arenas)
+//its nodes are allocated from local memory.
+//Partition i holds the keys in [boundaries[i-1], boundaries[i]), so the directory
+//is a single binary search and iteration over the partitions stays in order.
+//Lookups run on the calling thread under a shared lock of the partition, which the
+//worker holds exclusively while it changes the partition.
+template <class T>
+class PartitionedBTree
+{
+	//Task of one caller, who waits until it's done
+	struct Job
+	{
+		std::function<void()> task;
+		std::exception_ptr error;
+		bool done;
+
+		Job() : done(false) {}
+	};
+
+	//Runs the queued jobs of its partition one at a time
+	struct Worker
+	{
+		std::thread thread;
+		std::mutex lock;
+		std::condition_variable wake;
+		std::condition_variable done;
+		std::deque<Job*> jobs;
+		bool stopping;
+
+		std::shared_mutex tree_lock;
+
+		Worker() : stopping(false) {}
+	};
+
+	std::vector<T> boundaries;
+	std::vector<BTree<T>*> partitions;
+	std::vector<std::unique_ptr<Worker> > workers;
+	std::vector<std::vector<int> > numa_cpus;//cpus of every NUMA node
+
+	static std::vector<std::vector<int> > read_numa_cpus();
+	static std::vector<int> parse_cpu_list(const std::string& list);
+	static bool pin_thread(const std::vector<int>& cpus);
+
+	void worker_loop(Worker *worker, int partition);
+	void post(int partition, Job& job);
+	void wait_for(int partition, Job& job, std::exception_ptr& error);
+
+	template <class F>
+	void run_on_partition(int partition, F function);
+	template <class F>
+	void run_on_partitions(const std::vector<bool>& selected, F function);
+
+public:
+	PartitionedBTree(const std::vector<T>& boundaries, int max_node_degree = 3);
+	PartitionedBTree(const PartitionedBTree&) = delete;
+	PartitionedBTree& operator=(const PartitionedBTree&) = delete;
+	~PartitionedBTree();
+
+	void insert(const T& data);
+	void remove(const T& data);
+	void insert_multiple(const std::vector<T>& list);
+	void remove_multiple(const std::vector<T>& list);
+
+	bool contains(const T& data) const;
+	bool is_empty() const;
+
+	template <class F>
+	void for_each_inorder(F function) const;
+
+	int partition_of(const T& data) const;
+	int partition_count() const;
+	BTree<T>& partition(int index);
+	const BTree<T>& partition(int index) const;
+
+	int numa_node_count() const;
+	int numa_node_of(int partition) const;
+	bool pin_to_partition(int partition) const;
+};
+
+//NUMA nodes are listed in /sys/devices/system/node, a machine without them is a single node
+template <class T>
+std::vector<std::vector<int> > PartitionedBTree<T>::read_numa_cpus()
+{
+	std::vector<std::vector<int> > cpus;
+	for (int node=0; ; node++)
+	{
+		std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+		std::string list;
+		if (!file || !std::getline(file, list))
+			break;
+		cpus.push_back(parse_cpu_list(list));
+	}
+
+	if (cpus.empty())
+		cpus.push_back(std::vector<int>());//no pinning
+	return cpus;
+}
+
+//List is in the kernel format, e.g. "0-3,8-11"
+template <class T>
+std::vector<int> PartitionedBTree<T>::parse_cpu_list(const std::string& list)
+{
+	std::vector<int> cpus;
+	std::istringstream ranges(list);
+	std::string range;
+	while (std::getline(ranges, range, ','))
+	{
+		int first, last;
+		char dash;
+		std::istringstream numbers(range);
+		if (!(numbers >> first))
+			continue;
+		if (!(numbers >> dash >> last))
+			last = first;
+
+		for (int cpu=first; cpu <= last; cpu++)
+			cpus.push_back(cpu);
+	}
+	return cpus;
+}
+
+template <class T>
+bool PartitionedBTree<T>::pin_thread(const std::vector<int>& cpus)
+{
+#ifdef __linux__
+	if (cpus.empty())
+		return false;
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (int i=0; i < (int)cpus.size(); i++)
+		CPU_SET(cpus[i], &set);
+	return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+	return false;
+#endif
+}
+
+template <class T>
+void PartitionedBTree<T>::worker_loop(Worker *worker, int partition)
+{
+	pin_thread(this->numa_cpus[this->numa_node_of(partition)]);
+
+	std::unique_lock<std::mutex> lock(worker->lock);
+	while (true)
+	{
+		worker->wake.wait(lock, [worker]() {return !worker->jobs.empty() || worker->stopping;});
+		if (worker->jobs.empty())
+			return;
+
+		Job *job = worker->jobs.front();
+		worker->jobs.pop_front();
+		lock.unlock();
+
+		std::exception_ptr error;
+		try
+		{
+			std::unique_lock<std::shared_mutex> tree_lock(worker->tree_lock);
+			job->task();
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+
+		lock.lock();
+		job->error = error;
+		job->done = true;
+		worker->done.notify_all();
+	}
+}
+
+//Job stays owned by the caller, it must live until wait_for returns
+template <class T>
+void PartitionedBTree<T>::post(int partition, Job& job)
+{
+	Worker& worker = *this->workers[partition];
+	std::lock_guard<std::mutex> lock(worker.lock);
+	worker.jobs.push_back(&job);
+	worker.wake.notify_one();
+}
+
+//Waits until the job is done, its exception is kept in error if there was none before
+template <class T>
+void PartitionedBTree<T>::wait_for(int partition, Job& job, std::exception_ptr& error)
+{
+	Worker& worker = *this->workers[partition];
+	std::unique_lock<std::mutex> lock(worker.lock);
+	worker.done.wait(lock, [&job]() {return job.done;});
+
+	if (job.error && !error)
+		error = job.error;
+}
+
+//Runs function(partition) on the worker of the partition and waits for it. A task that is
+//already on that worker (and holds the partition's lock) runs directly.
+template <class T>
+template <class F>
+void PartitionedBTree<T>::run_on_partition(int partition, F function)
+{
+	if (std::this_thread::get_id() == this->workers[partition]->thread.get_id())
+		return function(partition);
+
+	Job job;
+	job.task = [&function, partition]() {function(partition);};
+	std::exception_ptr error;
+	this->post(partition, job);
+	this->wait_for(partition, job, error);
+	if (error)
+		std::rethrow_exception(error);
+}
+
+//Selected partitions work in parallel, each on its own worker. Partitions are
+//independent trees, so the workers never touch the same nodes.
+template <class T>
+template <class F>
+void PartitionedBTree<T>::run_on_partitions(const std::vector<bool>& selected, F function)
+{
+	std::vector<Job> jobs(selected.size());
+	for (int i=0; i < (int)selected.size(); i++)
+		if (selected[i])
+		{
+			jobs[i].task = [&function, i]() {function(i);};
+			this->post(i, jobs[i]);
+		}
+
+	std::exception_ptr error;
+	for (int i=0; i < (int)selected.size(); i++)
+		if (selected[i])
+			this->wait_for(i, jobs[i], error);
+	if (error)
+		std::rethrow_exception(error);
+}
+
+template <class T>
+PartitionedBTree<T>::PartitionedBTree(const std::vector<T>& boundaries, int max_node_degree) : boundaries(boundaries)
+{
+	for (int i=1; i < (int)boundaries.size(); i++)
+		if (!(boundaries[i-1] < boundaries[i]))
+			throw("Partition boundaries must be strictly increasing!");
+	if (max_node_degree < 3)
+		throw("BTree max node degree cannot be less than 3!");
+
+	this->numa_cpus = read_numa_cpus();
+	this->partitions.resize(boundaries.size()+1, nullptr);
+	for (int i=0; i < (int)this->partitions.size(); i++)
+	{
+		this->workers.push_back(std::unique_ptr<Worker>(new Worker));
+		this->workers[i]->thread = std::thread(&PartitionedBTree::worker_loop, this, this->workers[i].get(), i);
+	}
+
+	//Even the tree objects are created on their own NUMA node
+	this->run_on_partitions(std::vector<bool>(this->partitions.size(), true), [&](int i)
+	{
+		this->partitions[i] = new BTree<T>(max_node_degree);
+	});
+}
+
+template <class T>
+PartitionedBTree<T>::~PartitionedBTree()
+{
+	//Nodes are freed by the threads that allocated them
+	this->run_on_partitions(std::vector<bool>(this->partitions.size(), true), [&](int i)
+	{
+		delete this->partitions[i];
+	});
+
+	for (int i=0; i < (int)this->workers.size(); i++)
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->workers[i]->lock);
+			this->workers[i]->stopping = true;
+			this->workers[i]->wake.notify_one();
+		}
+		this->workers[i]->thread.join();
+	}
+}
+
+//Changes run on the worker of the partition, lookups on the calling thread
+template <class T>
+void PartitionedBTree<T>::insert(const T& data)
+{
+	this->run_on_partition(this->partition_of(data), [&](int i)
+	{
+		this->partitions[i]->insert(data);
+	});
+}
+
+template <class T>
+void PartitionedBTree<T>::remove(const T& data)
+{
+	this->run_on_partition(this->partition_of(data), [&](int i)
+	{
+		this->partitions[i]->remove(data);
+	});
+}
+
+template <class T>
+void PartitionedBTree<T>::insert_multiple(const std::vector<T>& list)
+{
+	std::vector<std::vector<T> > batches(this->partitions.size());
+	std::vector<bool> selected(this->partitions.size(), false);
+	for (int i=0; i < (int)list.size(); i++)
+	{
+		int index = this->partition_of(list[i]);
+		batches[index].push_back(list[i]);
+		selected[index] = true;
+	}
+
+	this->run_on_partitions(selected, [&](int i)
+	{
+		this->partitions[i]->insert_multiple(batches[i]);
+	});
+}
+
+template <class T>
+void PartitionedBTree<T>::remove_multiple(const std::vector<T>& list)
+{
+	std::vector<std::vector<T> > batches(this->partitions.size());
+	std::vector<bool> selected(this->partitions.size(), false);
+	for (int i=0; i < (int)list.size(); i++)
+	{
+		int index = this->partition_of(list[i]);
+		batches[index].push_back(list[i]);
+		selected[index] = true;
+	}
+
+	this->run_on_partitions(selected, [&](int i)
+	{
+		this->partitions[i]->remove_multiple(batches[i]);
+	});
+}
+
+template <class T>
+bool PartitionedBTree<T>::contains(const T& data) const
+{
+	int index = this->partition_of(data);
+	std::shared_lock<std::shared_mutex> lock(this->workers[index]->tree_lock);
+	return this->partitions[index]->contains(data);
+}
+
+template <class T>
+bool PartitionedBTree<T>::is_empty() const
+{
+	for (int i=0; i < (int)this->partitions.size(); i++)
+	{
+		std::shared_lock<std::shared_mutex> lock(this->workers[i]->tree_lock);
+		if (!this->partitions[i]->is_empty())
+			return false;
+	}
+	return true;
+}
+
+//Partitions are read locked one at a time, changes can go on in the others meanwhile
+template <class T>
+template <class F>
+void PartitionedBTree<T>::for_each_inorder(F function) const
+{
+	for (int i=0; i < (int)this->partitions.size(); i++)
+	{
+		std::shared_lock<std::shared_mutex> lock(this->workers[i]->tree_lock);
+		this->partitions[i]->for_each_inorder(function);
+	}
+}
+
+template <class T>
+int PartitionedBTree<T>::partition_of(const T& data) const
+{
+	return std::upper_bound(this->boundaries.begin(), this->boundaries.end(), data) - this->boundaries.begin();
+}
+
+template <class T>
+int PartitionedBTree<T>::partition_count() const {return this->partitions.size();}
+
+template <class T>
+BTree<T>& PartitionedBTree<T>::partition(int index)
+{
+	if (index < 0 || index >= (int)this->partitions.size())
+		throw("Partition index is out of range!");
+	return *this->partitions[index];
+}
+
+template <class T>
+const BTree<T>& PartitionedBTree<T>::partition(int index) const
+{
+	if (index < 0 || index >= (int)this->partitions.size())
+		throw("Partition index is out of range!");
+	return *this->partitions[index];
+}
+
+template <class T>
+int PartitionedBTree<T>::numa_node_count() const {return this->numa_cpus.size();}
+
+//Partitions go round robin over the NUMA nodes
+template <class T>
+int PartitionedBTree<T>::numa_node_of(int partition) const
+{
+	return partition % this->numa_cpus.size();
+}
+
+//Pins the calling thread to the NUMA node of given partition, false if it's not possible
+template <class T>
+bool PartitionedBTree<T>::pin_to_partition(int partition) const
+{
+	if (partition < 0 || partition >= (int)this->partitions.size())
+		throw("Partition index is out of range!");
+	return pin_thread(this->numa_cpus[this->numa_node_of(partition)]);
+}
+
+#endif
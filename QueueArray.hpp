@@ -0,0 +1,138 @@
+#ifndef QUEUE_ARRAY_HPP
+#define QUEUE_ARRAY_HPP
+
+#include <new>
+#include <utility>
+
+//Queue with the interface of Queue<T> (QueueLinkedList.hpp) on a ring buffer.
+//First inline_capacity elements are stored inside the object like ArrayStack.
+template <class T, int inline_capacity = 16>
+class ArrayQueue
+{
+	T inline_data[inline_capacity];
+	T *data;
+	int capacity;
+	int front;
+	int queue_length;
+
+	void grow();
+
+public:
+	ArrayQueue() : data(inline_data), capacity(inline_capacity), front(0), queue_length(0) {}
+	ArrayQueue(const ArrayQueue& q) : ArrayQueue() {*this = q;}
+	~ArrayQueue()
+	{
+		if (this->data != this->inline_data)
+			delete[] this->data;
+	}
+
+	void enqueue(T data);
+	T dequeue();
+
+	const int& length() const;
+	const T& front_element() const;
+
+	void clear();
+
+	bool is_empty() const;
+	bool is_full() const;
+
+	ArrayQueue& operator=(const ArrayQueue& rhs);
+};
+
+template <class T, int inline_capacity>
+void ArrayQueue<T, inline_capacity>::grow()
+{
+	T *bigger = new T[2*this->capacity];
+	for (int i=0; i < this->queue_length; i++)
+		bigger[i] = std::move(this->data[(this->front+i) % this->capacity]);
+
+	if (this->data != this->inline_data)
+		delete[] this->data;
+	this->data = bigger;
+	this->capacity *= 2;
+	this->front = 0;
+}
+
+template <class T, int inline_capacity>
+void ArrayQueue<T, inline_capacity>::enqueue(T data)
+{
+	if (this->queue_length == this->capacity)
+		this->grow();
+
+	int rear = this->front + this->queue_length;
+	if (rear >= this->capacity)
+		rear -= this->capacity;
+	this->data[rear] = std::move(data);
+	this->queue_length++;
+}
+
+template <class T, int inline_capacity>
+T ArrayQueue<T, inline_capacity>::dequeue()
+{
+	if (this->is_empty())
+		throw("Empty queue cannot be dequeued!");
+
+	T temp = std::move(this->data[this->front]);
+	if (++this->front == this->capacity)
+		this->front = 0;
+	this->queue_length--;
+	return temp;
+}
+
+template <class T, int inline_capacity>
+const int& ArrayQueue<T, inline_capacity>::length() const
+{
+	return this->queue_length;
+}
+
+template <class T, int inline_capacity>
+const T& ArrayQueue<T, inline_capacity>::front_element() const
+{
+	if (this->is_empty())
+		throw("Empty queue has no front element!");
+	return this->data[this->front];
+}
+
+template <class T, int inline_capacity>
+void ArrayQueue<T, inline_capacity>::clear()
+{
+	this->front = 0;
+	this->queue_length = 0;
+}
+
+template <class T, int inline_capacity>
+bool ArrayQueue<T, inline_capacity>::is_empty() const
+{
+	return this->queue_length == 0;
+}
+
+template <class T, int inline_capacity>
+bool ArrayQueue<T, inline_capacity>::is_full() const
+{
+	if (this->queue_length < this->capacity)
+		return false;
+
+	T *temp = new (std::nothrow) T[2*this->capacity];
+	if (temp == nullptr)
+		return true;
+	delete[] temp;
+	return false;
+}
+
+template <class T, int inline_capacity>
+ArrayQueue<T, inline_capacity>& ArrayQueue<T, inline_capacity>::operator=(const ArrayQueue& rhs)
+{
+	if (this != &rhs)
+	{
+		this->clear();
+		while (this->capacity < rhs.queue_length)
+			this->grow();
+		for (int i=0; i < rhs.queue_length; i++)
+			this->data[i] = rhs.data[(rhs.front+i) % rhs.capacity];
+		this->queue_length = rhs.queue_length;
+	}
+	return *this;
+}
+
+#endif
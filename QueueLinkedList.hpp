@@ -30,18 +30,8 @@ public:
 template <class T>
 void Queue<T>::enqueue(T data)
 {
-	if (this->rear != nullptr)
-	{
-		typename LinkedList<T>::Node *temp = new typename LinkedList<T>::Node(data);
-		this->rear->bind_next(temp);
-		this->list_length++;
-		this->rear = temp;
-	}
-	else
-	{
-		this->LinkedList<T>::insert_at(data, 0);
-		this->rear = this->get_index(0);	
-	}
+	this->LinkedList<T>::push_back(data);
+	this->rear = this->get_tail();
 }
 
 template <class T>
@@ -102,7 +92,7 @@ Queue<T>& Queue<T>::operator=(const Queue& rhs)
 			typename LinkedList<T>::Node *tracker = rhs.get_index(0);
 			while (tracker != nullptr)
 			{
-				this->enqueue(tracker);
+				this->enqueue(tracker->get_data());
 				tracker = tracker->get_next();
 			}
 		}
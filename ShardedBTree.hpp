@@ -0,0 +1,349 @@
+#ifndef SHARDED_BTREE_HPP
+#define SHARDED_BTREE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+#include "BTree.hpp"
+
+//Thread safe front end: the key space is range partitioned over several BTree<T>,
+//each behind its own reader-writer lock, so writers of different shards don't wait
+//for each other. Shard i holds the keys in [boundaries[i-1], boundaries[i]), only the
+//first boundaries.size()+1 shards are in use.
+//When a shard grows beyond max_skew times the average, its excess over the average is
+//passed on shard by shard towards the side with more room, by split_at and join. Only the
+//two shards of a move are locked, and only the nodes along the cut paths are touched.
+template <class T>
+class ShardedBTree
+{
+	struct Shard
+	{
+		BTree<T> tree;
+		mutable std::shared_mutex lock;
+		std::atomic<int> size;
+
+		//Own copy of the shard's range, checked under its lock. A missing bound is open.
+		T low, high;
+		bool has_low, has_high;
+
+		//After a rebalance that couldn't move anything, skew isn't checked until the shard is bigger
+		int quiet_until;
+
+		Shard(int max_node_degree) : tree(max_node_degree), size(0), has_low(false), has_high(false), quiet_until(0) {}
+
+		bool covers(const T& data) const;
+	};
+
+	//Held shared to read the boundaries, exclusively for a moment to change one
+	mutable std::shared_mutex directory_lock;
+	std::vector<T> boundaries;
+	std::vector<std::unique_ptr<Shard> > shards;
+
+	int max_node_degree;
+	double max_skew;
+	int min_rebalance_length;
+	std::atomic<int> data_length;
+
+	int shard_of(const T& data) const;
+	template <class L, class F>
+	void with_shard(const T& data, F function) const;
+
+	bool is_skewed(int shard_size) const;
+	void rebalance_shard(int index);
+	int move_elements(int from, int to, int count);
+
+public:
+	ShardedBTree(int shard_count = 8, int max_node_degree = 3, double max_skew = 2.0);
+	ShardedBTree(const ShardedBTree&) = delete;
+	ShardedBTree& operator=(const ShardedBTree&) = delete;
+
+	void insert(const T& data);
+	void remove(const T& data);
+	bool contains(const T& data) const;
+
+	template <class F>
+	void for_each_inorder(F function) const;
+
+	void rebalance();
+
+	int length() const;
+	bool is_empty() const;
+	int shard_count() const;
+	int shard_length(int index) const;
+};
+
+template <class T>
+bool ShardedBTree<T>::Shard::covers(const T& data) const
+{
+	return (!this->has_low || !(data < this->low)) && (!this->has_high || data < this->high);
+}
+
+template <class T>
+ShardedBTree<T>::ShardedBTree(int shard_count, int max_node_degree, double max_skew)
+{
+	if (shard_count < 1)
+		throw("Sharded B-Tree needs at least one shard!");
+	if (max_node_degree < 3)
+		throw("BTree max node degree cannot be less than 3!");
+	if (max_skew <= 1)
+		throw("Maximum skew must be greater than 1!");
+
+	for (int i=0; i < shard_count; i++)
+		this->shards.push_back(std::unique_ptr<Shard>(new Shard(max_node_degree)));
+
+	//No boundaries yet, everything goes to the first shard until it's skewed
+	this->max_node_degree = max_node_degree;
+	this->max_skew = max_skew;
+	this->min_rebalance_length = 64*shard_count;
+	this->data_length = 0;
+}
+
+template <class T>
+int ShardedBTree<T>::shard_of(const T& data) const
+{
+	std::shared_lock<std::shared_mutex> directory(this->directory_lock);
+	return std::upper_bound(this->boundaries.begin(), this->boundaries.end(), data) - this->boundaries.begin();
+}
+
+//Runs function(index, shard) with the shard of data locked by L (unique or shared lock).
+//A boundary can move while the lock is awaited, then the shard is looked up again.
+template <class T>
+template <class L, class F>
+void ShardedBTree<T>::with_shard(const T& data, F function) const
+{
+	while (true)
+	{
+		int index = this->shard_of(data);
+		Shard& shard = *this->shards[index];
+		L lock(shard.lock);
+		if (shard.covers(data))
+			return function(index, shard);
+	}
+}
+
+template <class T>
+bool ShardedBTree<T>::is_skewed(int shard_size) const
+{
+	int total = this->data_length;
+	return total >= this->min_rebalance_length && shard_size > this->max_skew*total/this->shards.size();
+}
+
+template <class T>
+void ShardedBTree<T>::insert(const T& data)
+{
+	int skewed_index = -1;
+	this->template with_shard<std::unique_lock<std::shared_mutex> >(data, [&](int index, Shard& shard)
+	{
+		//Sizes must be exact for the skew check
+		if (shard.tree.contains(data))
+			return;
+		shard.tree.insert(data);
+		shard.size++;
+		this->data_length++;
+		if (shard.size > shard.quiet_until && this->is_skewed(shard.size))
+			skewed_index = index;
+	});
+
+	//Shard lock is released first, rebalancing locks pairs of neighbours in order
+	if (skewed_index >= 0)
+		this->rebalance_shard(skewed_index);
+}
+
+template <class T>
+void ShardedBTree<T>::remove(const T& data)
+{
+	this->template with_shard<std::unique_lock<std::shared_mutex> >(data, [&](int, Shard& shard)
+	{
+		if (!shard.tree.contains(data))
+			return;
+		shard.tree.remove(data);
+		shard.size--;
+		this->data_length--;
+	});
+}
+
+template <class T>
+bool ShardedBTree<T>::contains(const T& data) const
+{
+	bool found = false;
+	this->template with_shard<std::shared_lock<std::shared_mutex> >(data, [&](int, const Shard& shard)
+	{
+		found = shard.tree.contains(data);
+	});
+	return found;
+}
+
+//All shards are read locked in index order (like rebalancing does), so no range moves while visiting
+template <class T>
+template <class F>
+void ShardedBTree<T>::for_each_inorder(F function) const
+{
+	std::vector<std::shared_lock<std::shared_mutex> > locks;
+	for (int i=0; i < (int)this->shards.size(); i++)
+		locks.push_back(std::shared_lock<std::shared_mutex>(this->shards[i]->lock));
+
+	for (int i=0; i < (int)this->shards.size(); i++)
+		this->shards[i]->tree.for_each_inorder(function);
+}
+
+//Brings the shard down to the average: its excess goes to the neighbour on the side that has
+//more room below the average (unused shards count as empty), which passes its own excess on,
+//until a shard can take the rest. So a neighbour that's as heavy doesn't stop the rebalance.
+template <class T>
+void ShardedBTree<T>::rebalance_shard(int index)
+{
+	int shard_count = this->shards.size();
+	int average = this->data_length/shard_count;
+
+	long room_left = 0, room_right = 0;
+	for (int i=0; i < shard_count; i++)
+		if (i < index)
+			room_left += average - this->shards[i]->size;
+		else if (i > index)
+			room_right += average - this->shards[i]->size;
+
+	int direction = room_right >= room_left ? 1 : -1;
+	long room = direction == 1 ? room_right : room_left;
+
+	int moved = 0;
+	for (int from=index; room > 0 && from+direction >= 0 && from+direction < shard_count; from += direction)
+	{
+		int to = from+direction;
+		std::unique_lock<std::shared_mutex> first(this->shards[std::min(from, to)]->lock);
+		std::unique_lock<std::shared_mutex> second(this->shards[std::max(from, to)]->lock);
+
+		//Sizes could have changed while the locks were awaited
+		int excess = this->shards[from]->size - average;
+		if (from == index && excess > room)
+			excess = room;
+		if (excess <= 0)
+			break;
+
+		int count = this->move_elements(from, to, excess);
+		if (count == 0)
+			break;
+		moved += count;
+	}
+
+	if (moved == 0)
+	{
+		Shard& shard = *this->shards[index];
+		std::unique_lock<std::shared_mutex> lock(shard.lock);
+		shard.quiet_until = shard.size + shard.size/4;
+	}
+}
+
+//Both shards must be locked exclusively. Count elements of shard from go to its neighbour to,
+//the new boundary is found by walking the shard up to the cut. Returns the number moved.
+template <class T>
+int ShardedBTree<T>::move_elements(int from, int to, int count)
+{
+	Shard& source = *this->shards[from];
+	Shard& target = *this->shards[to];
+	if (count > source.size)
+		count = source.size;
+	if (count < 1)
+		return 0;
+
+	//Moving left, boundary is the first element that stays (the upper bound of the range if all go)
+	T boundary;
+	if (to < from && count == source.size)
+	{
+		if (!source.has_high)
+			count--;
+		else
+			boundary = source.high;
+	}
+	if (count < 1)
+		return 0;
+
+	if (to > from || count < source.size)
+	{
+		int rank = to < from ? count : source.size - count;
+		typename BTree<T>::const_iterator tracker = source.tree.begin();
+		for (int i=0; i < rank; i++)
+			++tracker;
+		boundary = *tracker;
+	}
+
+	if (to > from)
+		target.tree.join(source.tree.split_at(boundary));
+	else
+	{
+		BTree<T> kept = source.tree.split_at(boundary);
+		target.tree.join(std::move(source.tree));
+		source.tree = std::move(kept);
+	}
+	source.size -= count;
+	target.size += count;
+	source.quiet_until = 0;
+	target.quiet_until = 0;
+
+	Shard& lower = to < from ? target : source;
+	Shard& upper = to < from ? source : target;
+	lower.high = boundary;
+	lower.has_high = true;
+	upper.low = boundary;
+	upper.has_low = true;
+
+	std::unique_lock<std::shared_mutex> directory(this->directory_lock);
+	int position = std::min(from, to);
+	if (position == (int)this->boundaries.size())
+		this->boundaries.push_back(boundary);//next shard is taken into use
+	else
+		this->boundaries[position] = boundary;
+	return count;
+}
+
+//Sweeps over the neighbouring pairs until every shard has its share, a pair is locked at a time
+template <class T>
+void ShardedBTree<T>::rebalance()
+{
+	int shard_count = this->shards.size();
+	for (int sweep=0; sweep < shard_count; sweep++)
+	{
+		bool balanced = true;
+		long placed = 0;
+		for (int i=0; i+1 < shard_count; i++)
+		{
+			Shard& left = *this->shards[i];
+			Shard& right = *this->shards[i+1];
+			std::unique_lock<std::shared_mutex> left_lock(left.lock), right_lock(right.lock);
+
+			int wanted = (long)(i+1)*this->data_length/shard_count - placed;
+			if (left.size > wanted)
+				this->move_elements(i, i+1, left.size - wanted);
+			else if (left.size < wanted && left.has_high)
+				this->move_elements(i+1, i, wanted - left.size);
+
+			placed += left.size;
+			if (left.size != wanted)
+				balanced = false;
+		}
+		if (balanced)
+			break;
+	}
+}
+
+template <class T>
+int ShardedBTree<T>::length() const {return this->data_length;}
+
+template <class T>
+bool ShardedBTree<T>::is_empty() const {return this->data_length == 0;}
+
+template <class T>
+int ShardedBTree<T>::shard_count() const {return this->shards.size();}
+
+template <class T>
+int ShardedBTree<T>::shard_length(int index) const
+{
+	if (index < 0 || index >= (int)this->shards.size())
+		throw("Shard index is out of range!");
+	return this->shards[index]->size;
+}
+
+#endif
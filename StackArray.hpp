@@ -0,0 +1,126 @@
+#ifndef STACK_ARRAY_HPP
+#define STACK_ARRAY_HPP
+
+#include <new>
+#include <utility>
+
+//Stack with the interface of Stack<T> (StackLinkedList.hpp) on contiguous memory.
+//First inline_capacity elements are stored inside the object, so short lived
+//stacks (e.g. paths from root to leaf) don't allocate at all.
+template <class T, int inline_capacity = 16>
+class ArrayStack
+{
+	T inline_data[inline_capacity];
+	T *data;
+	int capacity;
+	int stack_length;
+
+	void grow();
+
+public:
+	ArrayStack() : data(inline_data), capacity(inline_capacity), stack_length(0) {}
+	ArrayStack(const ArrayStack& stk) : ArrayStack() {*this = stk;}
+	~ArrayStack()
+	{
+		if (this->data != this->inline_data)
+			delete[] this->data;
+	}
+
+	void push(T data);
+	T pop();
+	const T& top() const;
+
+	const int& length() const;
+
+	void clear();
+
+	bool is_empty() const;
+	bool is_full() const;
+
+	ArrayStack& operator=(const ArrayStack& rhs);
+};
+
+template <class T, int inline_capacity>
+void ArrayStack<T, inline_capacity>::grow()
+{
+	T *bigger = new T[2*this->capacity];
+	for (int i=0; i < this->stack_length; i++)
+		bigger[i] = std::move(this->data[i]);
+
+	if (this->data != this->inline_data)
+		delete[] this->data;
+	this->data = bigger;
+	this->capacity *= 2;
+}
+
+template <class T, int inline_capacity>
+void ArrayStack<T, inline_capacity>::push(T data)
+{
+	if (this->stack_length == this->capacity)
+		this->grow();
+	this->data[this->stack_length++] = std::move(data);
+}
+
+template <class T, int inline_capacity>
+T ArrayStack<T, inline_capacity>::pop()
+{
+	if (this->is_empty())
+		throw("Empty stack cannot be popped!");
+	return std::move(this->data[--this->stack_length]);
+}
+
+template <class T, int inline_capacity>
+const T& ArrayStack<T, inline_capacity>::top() const
+{
+	if (this->is_empty())
+		throw("Empty stack has no data on top!");
+	return this->data[this->stack_length-1];
+}
+
+template <class T, int inline_capacity>
+const int& ArrayStack<T, inline_capacity>::length() const
+{
+	return this->stack_length;
+}
+
+template <class T, int inline_capacity>
+void ArrayStack<T, inline_capacity>::clear()
+{
+	this->stack_length = 0;
+}
+
+template <class T, int inline_capacity>
+bool ArrayStack<T, inline_capacity>::is_empty() const
+{
+	return this->stack_length == 0;
+}
+
+template <class T, int inline_capacity>
+bool ArrayStack<T, inline_capacity>::is_full() const
+{
+	if (this->stack_length < this->capacity)
+		return false;
+
+	T *temp = new (std::nothrow) T[2*this->capacity];
+	if (temp == nullptr)
+		return true;
+	delete[] temp;
+	return false;
+}
+
+template <class T, int inline_capacity>
+ArrayStack<T, inline_capacity>& ArrayStack<T, inline_capacity>::operator=(const ArrayStack& rhs)
+{
+	if (this != &rhs)
+	{
+		this->clear();
+		while (this->capacity < rhs.stack_length)
+			this->grow();
+		for (int i=0; i < rhs.stack_length; i++)
+			this->data[i] = rhs.data[i];
+		this->stack_length = rhs.stack_length;
+	}
+	return *this;
+}
+
+#endif
@@ -0,0 +1,213 @@
+#ifndef STRING_KEY_BLOCK_HPP
+#define STRING_KEY_BLOCK_HPP
+
+#include <string>
+#include <vector>
+#include "LinkedList.hpp"
+
+//Sorted string keys of a single node packed into one byte buffer.
+//The prefix shared by every key is stored once, and the first 8 bytes after it
+//are kept as big-endian integers so most comparisons never touch the buffer.
+class StringKeyBlock
+{
+	std::string prefix;
+	std::string buffer;
+	std::vector<unsigned long long> heads;
+	std::vector<int> offsets;
+
+	static unsigned long long make_head(const char *data, int length);
+	int compare_suffix(int index, const std::string& key, int from) const;
+
+public:
+	StringKeyBlock() {this->offsets.push_back(0);}
+	StringKeyBlock(const std::vector<std::string>& sorted_keys) : StringKeyBlock() {this->assign(sorted_keys);}
+	StringKeyBlock(const LinkedList<std::string>& sorted_keys) : StringKeyBlock() {this->assign(sorted_keys);}
+
+	void assign(const std::vector<std::string>& sorted_keys);
+	void assign(const LinkedList<std::string>& sorted_keys);
+	void clear();
+
+	int lower_bound(const std::string& key) const;
+	int find(const std::string& key) const;
+	bool contains(const std::string& key) const;
+	int compare_at(int index, const std::string& key) const;
+
+	std::string get_index(int index) const;
+	const std::string& common_prefix() const;
+
+	int length() const;
+	bool is_empty() const;
+	int memory_usage() const;
+
+	static std::string separator(const std::string& left, const std::string& right);
+};
+
+inline unsigned long long StringKeyBlock::make_head(const char *data, int length)
+{
+	unsigned long long head = 0;
+	for (int i=0; i < 8; i++)
+	{
+		head <<= 8;
+		if (i < length)
+			head |= (unsigned char)data[i];
+	}
+	return head;
+}
+
+inline void StringKeyBlock::assign(const std::vector<std::string>& sorted_keys)
+{
+	this->clear();
+	if (sorted_keys.empty())
+		return;
+
+	//Keys are sorted, so the common prefix of the whole block is the one of first and last key
+	const std::string& first = sorted_keys.front();
+	const std::string& last = sorted_keys.back();
+	int prefix_length = 0;
+	while (prefix_length < (int)first.size() && prefix_length < (int)last.size() && first[prefix_length] == last[prefix_length])
+		prefix_length++;
+	this->prefix = first.substr(0, prefix_length);
+
+	int total = 0;
+	for (int i=0; i < (int)sorted_keys.size(); i++)
+		total += sorted_keys[i].size() - prefix_length;
+	this->buffer.reserve(total);
+	this->heads.reserve(sorted_keys.size());
+	this->offsets.reserve(sorted_keys.size()+1);
+
+	for (int i=0; i < (int)sorted_keys.size(); i++)
+	{
+		if (i > 0 && !(sorted_keys[i-1] < sorted_keys[i]))
+			throw("String key block needs strictly ascending keys!");
+
+		const std::string& key = sorted_keys[i];
+		this->heads.push_back(make_head(key.data()+prefix_length, key.size()-prefix_length));
+		this->buffer.append(key, prefix_length, std::string::npos);
+		this->offsets.push_back(this->buffer.size());
+	}
+}
+
+inline void StringKeyBlock::assign(const LinkedList<std::string>& sorted_keys)
+{
+	std::vector<std::string> keys;
+	keys.reserve(sorted_keys.length());
+
+	if (!sorted_keys.is_empty())
+	{
+		typename LinkedList<std::string>::Node* tracker = sorted_keys.get_index(0);
+		while (tracker != nullptr)
+		{
+			keys.push_back(tracker->get_data());
+			tracker = tracker->get_next();
+		}
+	}
+	this->assign(keys);
+}
+
+inline void StringKeyBlock::clear()
+{
+	this->prefix.clear();
+	this->buffer.clear();
+	this->heads.clear();
+	this->offsets.clear();
+	this->offsets.push_back(0);
+}
+
+//Compares stored suffix at index with key[from...], both past the common prefix
+inline int StringKeyBlock::compare_suffix(int index, const std::string& key, int from) const
+{
+	int begin = this->offsets[index];
+	int length = this->offsets[index+1] - begin;
+	return -key.compare(from, std::string::npos, this->buffer, begin, length);
+}
+
+inline int StringKeyBlock::compare_at(int index, const std::string& key) const
+{
+	if (index < 0 || index >= this->length())
+		throw("Index out of scope!");
+
+	int prefix_length = this->prefix.size();
+	int prefix_order = key.compare(0, prefix_length, this->prefix);
+	if (prefix_order != 0)
+		return prefix_order < 0 ? 1 : -1;
+
+	unsigned long long head = make_head(key.data()+prefix_length, key.size()-prefix_length);
+	if (this->heads[index] != head)
+		return this->heads[index] < head ? -1 : 1;
+	return this->compare_suffix(index, key, prefix_length);
+}
+
+inline int StringKeyBlock::lower_bound(const std::string& key) const
+{
+	int prefix_length = this->prefix.size();
+	int prefix_order = key.compare(0, prefix_length, this->prefix);
+
+	//Key outside the prefix range is before or after every key of the block
+	if (prefix_order < 0)
+		return 0;
+	else if (prefix_order > 0)
+		return this->length();
+
+	unsigned long long head = make_head(key.data()+prefix_length, key.size()-prefix_length);
+	int low = 0, high = this->length();
+
+	while (low < high)
+	{
+		int middle = low + (high-low)/2;
+		bool stored_is_less;
+
+		if (this->heads[middle] != head)
+			stored_is_less = this->heads[middle] < head;
+		else
+			stored_is_less = this->compare_suffix(middle, key, prefix_length) < 0;
+
+		if (stored_is_less)
+			low = middle+1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+inline int StringKeyBlock::find(const std::string& key) const
+{
+	int index = this->lower_bound(key);
+	if (index < this->length() && this->compare_at(index, key) == 0)
+		return index;
+	return -1;
+}
+
+inline bool StringKeyBlock::contains(const std::string& key) const {return this->find(key) != -1;}
+
+inline std::string StringKeyBlock::get_index(int index) const
+{
+	if (index < 0 || index >= this->length())
+		throw("Index out of scope!");
+	return this->prefix + this->buffer.substr(this->offsets[index], this->offsets[index+1]-this->offsets[index]);
+}
+
+inline const std::string& StringKeyBlock::common_prefix() const {return this->prefix;}
+
+inline int StringKeyBlock::length() const {return this->heads.size();}
+
+inline bool StringKeyBlock::is_empty() const {return this->heads.empty();}
+
+inline int StringKeyBlock::memory_usage() const
+{
+	return sizeof(StringKeyBlock) + this->prefix.capacity() + this->buffer.capacity()
+		+ this->heads.capacity()*sizeof(unsigned long long) + this->offsets.capacity()*sizeof(int);
+}
+
+//Shortest string s with left < s <= right (suffix truncation of a separator key)
+inline std::string StringKeyBlock::separator(const std::string& left, const std::string& right)
+{
+	if (!(left < right))
+		throw("Separator needs left key smaller than right key!");
+
+	int i = 0;
+	while (i < (int)left.size() && left[i] == right[i])
+		i++;
+	return right.substr(0, i+1);
+}
+
+#endif